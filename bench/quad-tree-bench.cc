@@ -0,0 +1,92 @@
+//////////////////////////////////////////////////////
+// @fileoverview Strict against loose quad tree: 20k
+//				 circles moving a little every frame.
+//				 See bench/run-benchmarks.sh.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <vector>
+
+#include "../math/vector_2.h"
+#include "../colliders/collider.h"
+#include "../colliders/shapes.h"
+#include "../scene/collider-pool.h"
+#include "../scene/collider-pair.h"
+#include "../scene/quad-tree.h"
+
+using namespace ysd_phy_2d;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+double Milliseconds(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Move every collider by up to 2 units and refit it one by one, then
+// query the pairs. Reports the mean time per frame.
+void Run(float min_radius, float max_radius, float looseness, int count, int frames)
+{
+	const float kWorldSize = 4096;
+	ColliderPool pool;
+	QuadTree tree(&pool, kWorldSize, kWorldSize, 8, looseness);
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> position(-kWorldSize / 2 + max_radius, kWorldSize / 2 - max_radius);
+	std::uniform_real_distribution<float> radius(min_radius, max_radius);
+	std::uniform_real_distribution<float> move(-2, 2);
+
+	std::vector<ColliderHandle> handles;
+	for (int i = 0; i < count; ++i)
+	{
+		std::unique_ptr<BaseCollider> collider(new CircleCollider(static_cast<uint16_t>(i), std::make_shared<Circle>(radius(rng))));
+		collider->Translate(Vector2(position(rng), position(rng)));
+		handles.push_back(pool.Add(std::move(collider)));
+		tree.Insert(handles.back());
+	}
+
+	PairBuffer pairs;
+	double move_time = 0, pair_time = 0;
+	std::size_t pair_count = 0;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		Clock::time_point start = Clock::now();
+		for (ColliderHandle handle : handles)
+		{
+			tree.Move(handle, Vector2(move(rng), move(rng)));
+		}
+		move_time += Milliseconds(start);
+
+		start = Clock::now();
+		tree.QueryPairs(pairs);
+		pair_time += Milliseconds(start);
+		pair_count += pairs.size();
+	}
+
+	std::printf("radius %4.0f-%-4.0f looseness %.1f: move %6.2f ms, pairs %6.2f ms, %zu pairs/frame\n",
+				min_radius, max_radius, looseness, move_time / frames, pair_time / frames, pair_count / frames);
+}
+
+}
+
+// @param	argv[1]	Number of colliders, 20000 by default.
+// @param	argv[2]	Number of frames, 50 by default.
+int main(int argc, char** argv)
+{
+	int count = argc > 1 ? std::atoi(argv[1]) : 20000;
+	int frames = argc > 2 ? std::atoi(argv[2]) : 50;
+
+	Run(1, 8, 1, count, frames);
+	Run(1, 8, 2, count, frames);
+	Run(4, 64, 1, count, frames);
+	Run(4, 64, 1.5f, count, frames);
+	return 0;
+}
@@ -0,0 +1,16 @@
+#!/bin/sh
+# Build and run the benchmarks with optimizations. Run from anywhere:
+#   sh bench/run-benchmarks.sh [extra compiler flags...]
+cd "$(dirname "$0")/.." || exit 1
+
+CXX=${CXX:-g++}
+OUT=${OUT:-/tmp/phy-2d-bench}
+SOURCES="math/vector_2.cc common/thread-pool.cc $(ls colliders/*.cc scene/*.cc | grep -v 'colliders/shape.cc')"
+
+mkdir -p "$OUT"
+for bench in bench/*-bench.cc; do
+	name=$(basename "$bench" .cc)
+	$CXX -std=c++14 -O2 -DNDEBUG -pthread "$@" "$bench" $SOURCES -o "$OUT/$name" || exit 1
+	echo "== $name"
+	"$OUT/$name"
+done
@@ -0,0 +1,130 @@
+//////////////////////////////////////////////////////
+// @fileoverview A step of the world API: 8k circles
+//				 and polygons, the sizes of the hot
+//				 types and the phases of Update timed
+//				 one by one. See bench/run-benchmarks.sh.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "../cdsys-main.cc"
+
+using namespace ysd_phy_2d;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+double Milliseconds(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+}
+
+// Every 4th collider is a circle with a callback, the others are
+// pentagons. Everything moves and turns every frame. The phases are run
+// the way Update runs them, the narrow phase with the warm starts of
+// the GJK cache.
+// @param	argv[1]	Number of colliders, 8000 by default.
+// @param	argv[2]	Number of frames, 30 by default.
+// @param	argv[3]	Number of threads, 1 by default.
+int main(int argc, char** argv)
+{
+	const int count = argc > 1 ? std::atoi(argv[1]) : 8000;
+	const int frames = argc > 2 ? std::atoi(argv[2]) : 30;
+	const uint32_t threads = argc > 3 ? static_cast<uint32_t>(std::atoi(argv[3])) : 1;
+
+	std::printf("sizeof Vector2 %zu, Bound %zu, Collision %zu, QuadTree::TreeNode %zu\n",
+				sizeof(Vector2), sizeof(Bound), sizeof(Collision), sizeof(QuadTree::TreeNode));
+
+	CreateWorld(kQuadTreeBroadPhase, 4000, 4000);
+	SetThreadCount(threads);
+
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> position(-200, 200);
+	std::uniform_real_distribution<float> move(-1, 1);
+
+	std::size_t callback_count = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		uint16_t id = static_cast<uint16_t>(i);
+		if (i % 4 == 0)
+		{
+			OnDetectedCallback callback = [&callback_count](const Collision&) { ++callback_count; };
+			AddCircleCollider(id, position(rng), position(rng), 2, { callback, callback, callback });
+		}
+		else
+		{
+			float xy[] = { -2, -2, 2, -2, 3, 1, 0, 3, -2, 1 };
+			AddPolygonCollider(id, position(rng), position(rng), xy, 10);
+		}
+	}
+
+	std::vector<uint16_t> ids(count);
+	std::vector<float> positions(count * 2), angles(count);
+	for (int i = 0; i < count; ++i)
+	{
+		ids[i] = static_cast<uint16_t>(i);
+	}
+
+	double transform_time = 0, refit_time = 0, pair_time = 0, narrow_time = 0, delivery_time = 0;
+	std::size_t pair_count = 0, collision_count = 0;
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			ColliderHandle handle = g_collider_pool.Find(ids[i]);
+			positions[i * 2] = g_collider_pool.position(handle).x() + move(rng);
+			positions[i * 2 + 1] = g_collider_pool.position(handle).y() + move(rng);
+			angles[i] = move(rng) * 3;
+		}
+
+		// The transforms and bounds of the colliders.
+		Clock::time_point start = Clock::now();
+		SetTransforms(ids.data(), positions.data(), angles.data(), nullptr, count);
+		transform_time += Milliseconds(start);
+
+		start = Clock::now();
+		g_broad_phase->RefitBatch(g_dirty_handles.data(), g_dirty_handles.size());
+		g_dirty_handles.clear();
+		refit_time += Milliseconds(start);
+
+		start = Clock::now();
+		g_broad_phase->QueryPairs(g_pairs);
+		pair_time += Milliseconds(start);
+		pair_count += g_pairs.size();
+
+		start = Clock::now();
+		NarrowPhase();
+		narrow_time += Milliseconds(start);
+		collision_count += g_collisions.size();
+
+		start = Clock::now();
+		g_contacts.BeginFrame();
+		for (const Collision& collision : g_collisions)
+		{
+			bool entered = g_contacts.Touch(collision.first, collision.second);
+			OnCollide(collision, entered ? kOnColliderEnter : kOnColliderStay);
+		}
+		g_contacts.EndFrame([](uint16_t id1, uint16_t id2) {
+			Collision collision;
+			collision.first = id1;
+			collision.second = id2;
+			OnCollide(collision, kOnColliderExit);
+		});
+		delivery_time += Milliseconds(start);
+	}
+
+	std::printf("%d colliders, %u threads: transforms %6.2f ms, refit %6.2f ms, pairs %6.2f ms, narrow phase %6.2f ms, delivery %6.2f ms\n",
+				count, threads, transform_time / frames, refit_time / frames, pair_time / frames, narrow_time / frames, delivery_time / frames);
+	std::printf("%zu pairs/frame, %zu collisions/frame, %zu callbacks/frame\n",
+				pair_count / frames, collision_count / frames, callback_count / frames);
+	return 0;
+}
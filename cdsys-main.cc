@@ -3,17 +3,175 @@
 // @author	ysd
 ////////////////////////////////////////////////////////
 
-#include <map>
 #include <memory>
 #include <array>
+#include <vector>
+#include <algorithm>
 #include <assert.h>
 
 #include "./colliders/collider.h"
+#include "./colliders/circle-batch.h"
+#include "./colliders/gjk-cache.h"
+#include "./colliders/time-of-impact.h"
+#include "./colliders/collision.h"
+#include "./common/span.h"
+#include "./common/thread-pool.h"
+#include "./scene/broad-phase.h"
 #include "./scene/quad-tree.h"
+#include "./scene/sweep-and-prune.h"
+#include "./scene/aabb-tree.h"
+#include "./scene/spatial-hash.h"
+#include "./scene/contact-table.h"
+#include "./scene/event-stream.h"
+#include "./scene/world-snapshot.h"
 
 using namespace ysd_phy_2d;
 
-QuadTree g_quad_tree;
+// All colliders in the physics world.
+ColliderPool g_collider_pool;
+
+// Broad phase of the physics world, created by CreateWorld.
+std::unique_ptr<BroadPhase> g_broad_phase;
+
+// Detection callbacks of every collider, indexed by handle like the
+// arrays of the pool.
+std::vector<std::array<OnDetectedCallback, 3>> g_callbacks;
+
+// Candidate pairs found by broad phase. Reused every frame.
+PairBuffer g_pairs;
+
+// Pairs checked by a narrow phase task.
+const uint32_t kNarrowPhaseChunk = 256;
+
+// Narrow phase state of a thread. Reused every frame.
+struct NarrowPhaseContext
+{
+	// Circle pairs of a chunk, checked in one batch.
+	CirclePairBatch circle_pairs;
+
+	// Index in g_pairs of every pair in circle_pairs.
+	std::vector<uint32_t> circle_pair_indices;
+
+	// Collisions found by the thread, chunk after chunk.
+	CollisionBuffer collisions;
+};
+
+// Collisions of a chunk in the buffer of the thread that checked it.
+struct ChunkCollisions
+{
+	uint32_t thread;
+	uint32_t begin;
+	uint32_t end;
+};
+
+// Threads of the narrow phase. Only the calling thread by default.
+std::unique_ptr<ThreadPool> g_thread_pool(new ThreadPool(1));
+
+// One context per thread of g_thread_pool.
+std::vector<std::unique_ptr<NarrowPhaseContext>> g_narrow_phase_contexts;
+
+// Collisions of every chunk of the frame, merged in chunk order.
+std::vector<ChunkCollisions> g_chunk_collisions;
+
+// Cache entry of the warm start of every polygon pair in g_pairs,
+// GjkCache::kNoEntry for the other pairs. They are looked up before the
+// narrow phase fans out.
+std::vector<uint32_t> g_warm_starts;
+
+// Collisions of the frame. The callbacks get references into it.
+CollisionBuffer g_collisions;
+
+// Pairs that touched in the last frame, to tell enter, stay and exit apart.
+ContactTable g_contacts;
+
+// How the contact events of a frame are delivered.
+enum EventDelivery
+{
+	// Call the callbacks of both colliders for every event.
+	kCallbackDelivery = 0,
+
+	// Only record the events in g_events, the callbacks are not called.
+	kStreamDelivery = 1,
+};
+
+EventDelivery g_event_delivery = kCallbackDelivery;
+
+// Contact events of the frame when they are streamed.
+EventStream g_events;
+
+// GJK results of the polygon pairs, to start the next frame from.
+GjkCache g_gjk_cache;
+
+// Snapshots of the world published by Update for the query threads.
+SnapshotBuffer g_snapshots;
+
+// Update only publishes the snapshots after EnableSnapshots.
+bool g_publish_snapshots = false;
+
+// Number of Updates.
+uint64_t g_frame = 0;
+
+// Colliders moved by SetTransforms since the last Update. The broad phase
+// is fixed up for them at the start of Update.
+std::vector<ColliderHandle> g_dirty_handles;
+
+// Set the callbacks of a collider just added to the pool. A reused
+// handle drops the callbacks of its last collider.
+static void SetCallbacks(ColliderHandle handle, const std::array<OnDetectedCallback, 3>& callbacks)
+{
+	if (handle >= g_callbacks.size())
+	{
+		g_callbacks.resize(g_collider_pool.capacity());
+	}
+	g_callbacks[handle] = callbacks;
+}
+
+///////////////////////////////////////////////////////
+// Create the physics world. It must be called before
+// any collider is added.
+// @param[in]	type		Broad phase used by the world.
+// @param[in]	width		Size of the world. Only the quad
+// @param[in]	length		tree needs it. Colliders out of
+//							it still work, the tree keeps
+//							them in its root.
+// @param[in]	cell_size	Only the spatial hash needs it. A
+//							bit bigger than the colliders.
+// @param[in]	looseness	Only the quad tree uses it. Above
+//							1 the tree is loose, it fits
+//							colliders of mixed sizes, see
+//							QuadTree.
+// @param[in]	task_deep	Only the quad tree uses it. Deep
+//							of the subtrees refit and
+//							searched in parallel, see
+//							SetThreadCount.
+///////////////////////////////////////////////////////
+void CreateWorld(BroadPhaseType type, float width, float length, float cell_size = 16, float looseness = 1,
+				 uint8_t task_deep = QuadTree::kDefaultTaskDeep)
+{
+	assert(g_collider_pool.size() == 0);
+
+	switch (type)
+	{
+	case kQuadTreeBroadPhase:
+	{
+		QuadTree* tree = new QuadTree(&g_collider_pool, width, length, 8, looseness);
+		tree->set_task_deep(task_deep);
+		g_broad_phase.reset(tree);
+		break;
+	}
+	case kSweepAndPruneBroadPhase:
+		// Sweep along the longer side of the world.
+		g_broad_phase.reset(new SweepAndPrune(&g_collider_pool, width >= length ? 0 : 1));
+		break;
+	case kAabbTreeBroadPhase:
+		g_broad_phase.reset(new AabbTree(&g_collider_pool));
+		break;
+	case kSpatialHashBroadPhase:
+		g_broad_phase.reset(new SpatialHash(&g_collider_pool, cell_size));
+		break;
+	}
+	g_broad_phase->set_thread_pool(g_thread_pool.get());
+}
 
 ///////////////////////////////////////////////////////
 // Add a circle collider in the physics world.
@@ -21,8 +179,11 @@ QuadTree g_quad_tree;
 void AddCircleCollider(uint16_t id, float pos_x, float pos_y, float radius, std::array<OnDetectedCallback, 3> callbacks)
 {
 	std::shared_ptr<Circle> pcircle_shape = std::make_shared<Circle>(radius);
-	std::shared_ptr<CircleCollider> pcircle_collider = std::make_shared<CircleCollider>(id, pcircle_collider);
-	g_quad_tree.Insert(pcircle_collider);
+	std::unique_ptr<CircleCollider> pcircle_collider(new CircleCollider(id, pcircle_shape));
+	pcircle_collider->Translate(Vector2(pos_x, pos_y));
+	ColliderHandle handle = g_collider_pool.Add(std::move(pcircle_collider));
+	SetCallbacks(handle, callbacks);
+	g_broad_phase->Insert(handle);
 }
 
 ///////////////////////////////////////////////////////
@@ -49,8 +210,377 @@ void AddPolygonCollider(uint16_t id, float pos_x, float pos_y, float* xy, std::s
 		vecs[i].set_y(xy[i * 2 + 1]);
 	}
 	std::shared_ptr<ConvexPolygon> ppolygon = std::make_shared<ConvexPolygon>(vecs, size / 2);
-	std::shared_ptr<PolygonCollider> ppolygon_collider = std::make_shared<PolygonCollider>(id, ppolygon);
-	PolygonCollider c(id, ppolygon);
+	delete[] vecs;
+	std::unique_ptr<PolygonCollider> ppolygon_collider(new PolygonCollider(id, ppolygon));
+	ppolygon_collider->Translate(Vector2(pos_x, pos_y));
+	ColliderHandle handle = g_collider_pool.Add(std::move(ppolygon_collider));
+	SetCallbacks(handle, std::array<OnDetectedCallback, 3>());
+	g_broad_phase->Insert(handle);
+}
+
+// Description of a circle collider for AddCircleColliders.
+struct CircleColliderDesc
+{
+	uint16_t id;
+	float pos_x;
+	float pos_y;
+	float radius;
+	std::array<OnDetectedCallback, 3> callbacks;
+};
+
+// Description of a convex polygon collider for AddPolygonColliders.
+struct PolygonColliderDesc
+{
+	uint16_t id;
+	float pos_x;
+	float pos_y;
+
+	// Corners of the polygon, [x1, y1, x2, y2...]
+	float* xy;
+	std::size_t size;
+};
+
+///////////////////////////////////////////////////////
+// Add many circle colliders at once, e.g. when a level
+// is loaded. The broad phase indexes the whole batch in
+// one go, it is much faster than AddCircleCollider one
+// by one.
+///////////////////////////////////////////////////////
+void AddCircleColliders(const CircleColliderDesc* descs, std::size_t count)
+{
+	std::vector<ColliderHandle> handles(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const CircleColliderDesc& desc = descs[i];
+		std::shared_ptr<Circle> pcircle_shape = std::make_shared<Circle>(desc.radius);
+		std::unique_ptr<CircleCollider> pcircle_collider(new CircleCollider(desc.id, pcircle_shape));
+		pcircle_collider->Translate(Vector2(desc.pos_x, desc.pos_y));
+		handles[i] = g_collider_pool.Add(std::move(pcircle_collider));
+		SetCallbacks(handles[i], desc.callbacks);
+	}
+	g_broad_phase->InsertBatch(handles.data(), count);
+}
+
+///////////////////////////////////////////////////////
+// Add many convex polygon colliders at once.
+///////////////////////////////////////////////////////
+void AddPolygonColliders(const PolygonColliderDesc* descs, std::size_t count)
+{
+	std::vector<ColliderHandle> handles(count);
+	std::vector<Vector2> vecs;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const PolygonColliderDesc& desc = descs[i];
+		assert(desc.size % 2 == 0);
+
+		vecs.resize(desc.size / 2);
+		for (std::size_t j = 0; j < desc.size / 2; ++j)
+		{
+			vecs[j].set_x(desc.xy[j * 2]);
+			vecs[j].set_y(desc.xy[j * 2 + 1]);
+		}
+		std::shared_ptr<ConvexPolygon> ppolygon = std::make_shared<ConvexPolygon>(vecs.data(), desc.size / 2);
+		std::unique_ptr<PolygonCollider> ppolygon_collider(new PolygonCollider(desc.id, ppolygon));
+		ppolygon_collider->Translate(Vector2(desc.pos_x, desc.pos_y));
+		handles[i] = g_collider_pool.Add(std::move(ppolygon_collider));
+		SetCallbacks(handles[i], std::array<OnDetectedCallback, 3>());
+	}
+	g_broad_phase->InsertBatch(handles.data(), count);
+}
+
+///////////////////////////////////////////////////////
+// Set the transforms of many colliders in world space.
+// The broad phase is not touched until the next Update,
+// so a collider moved several times in a frame is only
+// fixed up once.
+// @param[in]	ids			Ids of the colliders.
+// @param[in]	positions	[x1, y1, x2, y2...]
+// @param[in]	angles		Angles in radian. Null to keep them.
+// @param[in]	scales		[x1, y1, x2, y2...] Null to keep them.
+// @param[in]	count		Number of the colliders.
+///////////////////////////////////////////////////////
+void SetTransforms(const uint16_t* ids, const float* positions, const float* angles, const float* scales, std::size_t count)
+{
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		ColliderHandle handle = g_collider_pool.Find(ids[i]);
+		if (handle == kInvalidHandle)
+			continue;
+
+		Vector2 position(positions[i * 2], positions[i * 2 + 1]);
+		float angle = angles != nullptr ? angles[i] : g_collider_pool.angle(handle);
+		Vector2 scale = scales != nullptr ? Vector2(scales[i * 2], scales[i * 2 + 1]) : g_collider_pool.scale(handle);
+		g_collider_pool.SetTransform(handle, position, angle, scale);
+		g_dirty_handles.push_back(handle);
+	}
+}
+
+// Narrow phase of a pair that is not two circles.
+// @param[in]	warm	Warm start of a polygon pair.
+static bool CheckPair(const BaseCollider* first, const BaseCollider* second, GjkWarmStart* warm, Collision* collision)
+{
+	if (first->type() == kPolygonColliderType && second->type() == kPolygonColliderType)
+	{
+		return DoCheck(*static_cast<const PolygonCollider*>(first),
+					   *static_cast<const PolygonCollider*>(second), warm, collision);
+	}
+
+	if (first->type() == kCircleColliderType)
+	{
+		return DoCheck(*static_cast<const CircleCollider*>(first),
+					   *static_cast<const PolygonCollider*>(second), collision);
+	}
+
+	// The circle is checked first, then the collision is turned around.
+	bool collided = DoCheck(*static_cast<const CircleCollider*>(second),
+							*static_cast<const PolygonCollider*>(first), collision);
+	if (collided)
+		collision->Flip();
+	return collided;
+}
+
+// Narrow phase of a pair with a continuous collider. If they do not
+// overlap at the end of the step, they may have touched on the way.
+static bool CheckSweptPair(const ColliderPair& pair, GjkWarmStart* warm, Collision* collision)
+{
+	const BaseCollider* first = g_collider_pool.collider(pair.first);
+	const BaseCollider* second = g_collider_pool.collider(pair.second);
+	bool collided = first->type() == kCircleColliderType && second->type() == kCircleColliderType ?
+		DoCheck(*static_cast<const CircleCollider*>(first), *static_cast<const CircleCollider*>(second), collision) :
+		CheckPair(first, second, warm, collision);
+	if (collided)
+		return true;
+
+	return TimeOfImpact(*first, g_collider_pool.sweep(pair.first),
+						*second, g_collider_pool.sweep(pair.second), collision);
+}
+
+// Check the pairs of a chunk and append the collisions to the thread's
+// buffer. The circle pairs are checked in one batch after the others.
+static void CheckChunk(uint32_t chunk, NarrowPhaseContext& context)
+{
+	std::size_t begin = static_cast<std::size_t>(chunk) * kNarrowPhaseChunk;
+	std::size_t end = std::min(begin + kNarrowPhaseChunk, g_pairs.size());
+
+	context.circle_pairs.Clear();
+	context.circle_pair_indices.clear();
+	for (std::size_t i = begin; i < end; ++i)
+	{
+		const ColliderPair& pair = g_pairs[i];
+		GjkWarmStart* warm = g_warm_starts[i] == GjkCache::kNoEntry ? nullptr : &g_gjk_cache.warm(g_warm_starts[i]);
+		if (g_collider_pool.continuous(pair.first) || g_collider_pool.continuous(pair.second))
+		{
+			Collision& collision = context.collisions.Push();
+			if (!CheckSweptPair(pair, warm, &collision))
+			{
+				context.collisions.Pop();
+			}
+			continue;
+		}
+
+		if (g_collider_pool.type(pair.first) == kCircleColliderType &&
+			g_collider_pool.type(pair.second) == kCircleColliderType)
+		{
+			context.circle_pairs.Push(g_collider_pool.position(pair.first), g_collider_pool.radius(pair.first),
+									  g_collider_pool.position(pair.second), g_collider_pool.radius(pair.second));
+			context.circle_pair_indices.push_back(static_cast<uint32_t>(i));
+			continue;
+		}
+
+		Collision& collision = context.collisions.Push();
+		if (!CheckPair(g_collider_pool.collider(pair.first), g_collider_pool.collider(pair.second),
+					   warm, &collision))
+		{
+			context.collisions.Pop();
+		}
+	}
+
+	context.circle_pairs.Check();
+	for (std::size_t i = 0, l = context.circle_pairs.size(); i < l; ++i)
+	{
+		if (!context.circle_pairs.hit(i))
+			continue;
+
+		const ColliderPair& pair = g_pairs[context.circle_pair_indices[i]];
+		Collision& collision = context.collisions.Push();
+		collision.first = g_collider_pool.id(pair.first);
+		collision.second = g_collider_pool.id(pair.second);
+		CircleContact(g_collider_pool.position(pair.first), g_collider_pool.radius(pair.first),
+					  g_collider_pool.position(pair.second), g_collider_pool.radius(pair.second),
+					  &collision);
+	}
+}
+
+// Check all pairs of g_pairs and write the collisions into g_collisions,
+// in the same order whatever the number of threads.
+static void NarrowPhase()
+{
+	while (g_narrow_phase_contexts.size() < g_thread_pool->thread_count())
+	{
+		g_narrow_phase_contexts.emplace_back(new NarrowPhaseContext());
+	}
+
+	// Everything shared by the threads is written before they start: the
+	// polygons' cached world data, and the warm starts, since the cache
+	// may add entries.
+	g_warm_starts.assign(g_pairs.size(), GjkCache::kNoEntry);
+	for (std::size_t i = 0, l = g_pairs.size(); i < l; ++i)
+	{
+		const ColliderPair& pair = g_pairs[i];
+		bool polygon1 = g_collider_pool.type(pair.first) == kPolygonColliderType;
+		bool polygon2 = g_collider_pool.type(pair.second) == kPolygonColliderType;
+		if (polygon1)
+			static_cast<const PolygonCollider*>(g_collider_pool.collider(pair.first))->UpdateCaches();
+		if (polygon2)
+			static_cast<const PolygonCollider*>(g_collider_pool.collider(pair.second))->UpdateCaches();
+		if (polygon1 && polygon2)
+			g_warm_starts[i] = g_gjk_cache.Get(g_collider_pool.id(pair.first), g_collider_pool.id(pair.second));
+	}
+
+	uint32_t chunk_count = static_cast<uint32_t>((g_pairs.size() + kNarrowPhaseChunk - 1) / kNarrowPhaseChunk);
+	g_chunk_collisions.resize(chunk_count);
+	for (std::unique_ptr<NarrowPhaseContext>& context : g_narrow_phase_contexts)
+	{
+		context->collisions.Clear();
+	}
+
+	auto check = [](uint32_t chunk, uint32_t thread) {
+		CollisionBuffer& collisions = g_narrow_phase_contexts[thread]->collisions;
+		ChunkCollisions& result = g_chunk_collisions[chunk];
+		result.thread = thread;
+		result.begin = static_cast<uint32_t>(collisions.size());
+		CheckChunk(chunk, *g_narrow_phase_contexts[thread]);
+		result.end = static_cast<uint32_t>(collisions.size());
+	};
+	g_thread_pool->ParallelFor(chunk_count, check);
+	g_gjk_cache.EndFrame();
+
+	// Merge the chunks in order.
+	g_collisions.Clear();
+	for (const ChunkCollisions& result : g_chunk_collisions)
+	{
+		const CollisionBuffer& collisions = g_narrow_phase_contexts[result.thread]->collisions;
+		g_collisions.Append(collisions.begin() + result.begin, collisions.begin() + result.end);
+	}
+}
+
+// Call the detection callback of a collider, if it has one and is still
+// in the world.
+static void OnCollide(uint16_t id, const Collision& collision, OnDetectedCallbackType type)
+{
+	ColliderHandle handle = g_collider_pool.Find(id);
+	if (handle == kInvalidHandle)
+		return;
+
+	const OnDetectedCallback& callback = g_callbacks[handle][type - 1];
+	if (callback)
+		callback(collision);
+}
+
+// Call the detection callbacks of both colliders of a collision.
+static void OnCollide(const Collision& collision, OnDetectedCallbackType type)
+{
+	OnCollide(collision.first, collision, type);
+	OnCollide(collision.second, collision, type);
+}
+
+///////////////////////////////////////////////////////
+// Collisions found by the last Update. They are valid
+// until the next Update.
+///////////////////////////////////////////////////////
+Span<const Collision> GetCollisions()
+{
+	return Span<const Collision>(g_collisions.begin(), g_collisions.end());
+}
+
+///////////////////////////////////////////////////////
+// Set the number of threads of the narrow phase and of
+// the quad tree, including the one calling Update. The collisions and
+// events come in the same order whatever the number.
+///////////////////////////////////////////////////////
+void SetThreadCount(uint32_t count)
+{
+	g_thread_pool.reset(new ThreadPool(count));
+	g_narrow_phase_contexts.clear();
+	if (g_broad_phase)
+	{
+		g_broad_phase->set_thread_pool(g_thread_pool.get());
+	}
+}
+
+///////////////////////////////////////////////////////
+// Let a fast collider, e.g. a bullet, find what it
+// passes through in a step instead of only where it
+// ends. Its bound covers the whole move in the broad
+// phase, and a pair that does not overlap at the end of
+// the step gets the time it first touches, see
+// Collision::time_of_impact. The other colliders do
+// not pay for it.
+///////////////////////////////////////////////////////
+void SetContinuous(uint16_t id, bool continuous)
+{
+	ColliderHandle handle = g_collider_pool.Find(id);
+	if (handle == kInvalidHandle)
+		return;
+
+	g_collider_pool.SetContinuous(handle, continuous);
+	g_dirty_handles.push_back(handle);
+}
+
+///////////////////////////////////////////////////////
+// Let Update publish a read-only snapshot of the world
+// at the end of every frame. Other threads can query
+// the last snapshot without locks while the next frame
+// is updated:
+//   uint32_t reader = AddSnapshotReader();	// once
+//   SnapshotBuffer::ReadGuard guard(g_snapshots, reader);
+//   if (guard.snapshot() != nullptr) ...
+///////////////////////////////////////////////////////
+void EnableSnapshots(bool enabled)
+{
+	g_publish_snapshots = enabled;
+}
+
+///////////////////////////////////////////////////////
+// Give a query thread its reader slot of the snapshots.
+// Thread safe, every thread calls it once.
+///////////////////////////////////////////////////////
+uint32_t AddSnapshotReader()
+{
+	return g_snapshots.AddReader();
+}
+
+///////////////////////////////////////////////////////
+// Choose how Update delivers the contact events. When
+// they are streamed, the callbacks are not called and
+// the events are read by GetEvents or DrainEvents.
+///////////////////////////////////////////////////////
+void SetEventDelivery(EventDelivery delivery)
+{
+	g_event_delivery = delivery;
+	g_events.Clear();
+}
+
+///////////////////////////////////////////////////////
+// Events of a kind streamed by the last Update. An
+// event refers to its contact data in GetCollisions().
+// They are valid until the next Update.
+///////////////////////////////////////////////////////
+Span<const ContactEvent> GetEvents(OnDetectedCallbackType type)
+{
+	return g_events.events(type);
+}
+
+///////////////////////////////////////////////////////
+// Hand the events streamed by the last Update to a
+// visitor, kind by kind, and clear them.
+// @param[in]	visitor		Has OnEnter, OnStay and OnExit,
+//							all take a const ContactEvent&.
+///////////////////////////////////////////////////////
+template <typename Visitor>
+void DrainEvents(Visitor& visitor)
+{
+	g_events.Drain(visitor);
 }
 
 ///////////////////////////////////////////////////////
@@ -58,7 +588,68 @@ void AddPolygonCollider(uint16_t id, float pos_x, float pos_y, float* xy, std::s
 ///////////////////////////////////////////////////////
 void Update()
 {
-	// Update the quad tree.
+	// Fix up the broad phase for the moved colliders, every collider once,
+	// in the order of the handles.
+	std::sort(g_dirty_handles.begin(), g_dirty_handles.end());
+	auto end = std::unique(g_dirty_handles.begin(), g_dirty_handles.end());
+	end = std::remove_if(g_dirty_handles.begin(), end, [](ColliderHandle handle) {
+		return g_collider_pool.collider(handle) == nullptr;
+	});
+	g_broad_phase->RefitBatch(g_dirty_handles.data(), end - g_dirty_handles.begin());
+	g_dirty_handles.clear();
+	++g_frame;
+
+	// Broad phase: collect all pairs whose bounds contact.
+	g_broad_phase->QueryPairs(g_pairs);
+
+	// Narrow phase, the pairs are split into chunks checked by the threads.
+	NarrowPhase();
 
-	// Check all possible collision in the game scene and call the detection callback.
+	// The next step of the continuous colliders starts here. Their swept
+	// bounds are fixed up by the next Update.
+	g_collider_pool.EndSweeps(&g_dirty_handles);
+
+	// The buffer does not grow any more, the references stay valid.
+	// A pair touching for the first time enters, otherwise it stays.
+	g_events.Clear();
+	g_contacts.BeginFrame();
+	if (g_event_delivery == kStreamDelivery)
+	{
+		for (std::size_t i = 0, l = g_collisions.size(); i < l; ++i)
+		{
+			const Collision& collision = g_collisions[i];
+			bool entered = g_contacts.Touch(collision.first, collision.second);
+			g_events.Push(entered ? kOnColliderEnter : kOnColliderStay,
+						  collision.first, collision.second, static_cast<uint32_t>(i));
+		}
+
+		g_contacts.EndFrame([](uint16_t id1, uint16_t id2) {
+			g_events.Push(kOnColliderExit, id1, id2, ContactEvent::kNoCollision);
+		});
+	}
+	else
+	{
+		for (const Collision& collision : g_collisions)
+		{
+			bool entered = g_contacts.Touch(collision.first, collision.second);
+			OnCollide(collision, entered ? kOnColliderEnter : kOnColliderStay);
+		}
+
+		// The pairs that touched in the last frame but not in this one exit.
+		// There is no contact data for them but the ids.
+		g_contacts.EndFrame([](uint16_t id1, uint16_t id2) {
+			Collision collision;
+			collision.first = id1;
+			collision.second = id2;
+			collision.normal = Vector2::kZero;
+			OnCollide(collision, kOnColliderExit);
+		});
+	}
+
+	// The step is done, including what the callbacks changed. The readers
+	// see the world as it ends.
+	if (g_publish_snapshots)
+	{
+		g_snapshots.Publish(g_collider_pool, g_frame);
+	}
 }
\ No newline at end of file
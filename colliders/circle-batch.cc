@@ -0,0 +1,67 @@
+#include "circle-batch.h"
+
+#include <cstring>
+
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace ysd_phy_2d;
+
+void ysd_phy_2d::CheckCirclePairs(const float* x1, const float* y1, const float* r1,
+								  const float* x2, const float* y2, const float* r2,
+								  std::size_t count, uint64_t* hits)
+{
+	// An empty batch may have no mask at all.
+	if (count == 0)
+		return;
+	std::memset(hits, 0, (count + 63) / 64 * sizeof(uint64_t));
+
+	std::size_t i = 0;
+
+	// The lanes of a step never cross a word of the mask, since 64 is a
+	// multiple of the step.
+#if defined(__AVX512F__)
+	for (; i + 16 <= count; i += 16)
+	{
+		__m512 dx = _mm512_sub_ps(_mm512_loadu_ps(x1 + i), _mm512_loadu_ps(x2 + i));
+		__m512 dy = _mm512_sub_ps(_mm512_loadu_ps(y1 + i), _mm512_loadu_ps(y2 + i));
+		__m512 r = _mm512_add_ps(_mm512_loadu_ps(r1 + i), _mm512_loadu_ps(r2 + i));
+		__m512 d = _mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy));
+		__mmask16 mask = _mm512_cmp_ps_mask(d, _mm512_mul_ps(r, r), _CMP_LT_OQ);
+		hits[i >> 6] |= static_cast<uint64_t>(mask) << (i & 63);
+	}
+#elif defined(__AVX2__)
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x1 + i), _mm256_loadu_ps(x2 + i));
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y1 + i), _mm256_loadu_ps(y2 + i));
+		__m256 r = _mm256_add_ps(_mm256_loadu_ps(r1 + i), _mm256_loadu_ps(r2 + i));
+		__m256 d = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(d, _mm256_mul_ps(r, r), _CMP_LT_OQ));
+		hits[i >> 6] |= static_cast<uint64_t>(mask) << (i & 63);
+	}
+#elif defined(__SSE2__)
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(x1 + i), _mm_loadu_ps(x2 + i));
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(y1 + i), _mm_loadu_ps(y2 + i));
+		__m128 r = _mm_add_ps(_mm_loadu_ps(r1 + i), _mm_loadu_ps(r2 + i));
+		__m128 d = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+		int mask = _mm_movemask_ps(_mm_cmplt_ps(d, _mm_mul_ps(r, r)));
+		hits[i >> 6] |= static_cast<uint64_t>(mask) << (i & 63);
+	}
+#endif
+
+	// The rest, or all pairs without SIMD.
+	for (; i < count; ++i)
+	{
+		float dx = x1[i] - x2[i];
+		float dy = y1[i] - y2[i];
+		float r = r1[i] + r2[i];
+		if (dx * dx + dy * dy < r * r)
+		{
+			hits[i >> 6] |= uint64_t(1) << (i & 63);
+		}
+	}
+}
@@ -0,0 +1,94 @@
+//////////////////////////////////////////////////////
+// @fileoverview Batched narrow phase of circle pairs.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#ifndef _CIRCLE_BATCH_H_
+#define _CIRCLE_BATCH_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "../math/vector_2.h"
+#include "../common/un-copy-move-interface.h"
+
+namespace ysd_phy_2d
+{
+
+// Check count circle pairs, the ith pair is the ith element of all arrays.
+// The pair collide if the distance of the centers is smaller than the
+// sum of the radius, same as DoCheck of two circles.
+//
+// The pairs are checked 16, 8 or 4 at a time with AVX-512, AVX2 or SSE2,
+// whichever the target supports.
+//
+// @param[out]	hits	Bit i of hits[i / 64] is set if the ith pair
+//						collide. At least (count + 63) / 64 words.
+void CheckCirclePairs(const float* x1, const float* y1, const float* r1,
+					  const float* x2, const float* y2, const float* r2,
+					  std::size_t count, uint64_t* hits);
+
+/////////////////////////////////////////////////////////
+// A CirclePairBatch collect the circle pairs of a frame
+// in structure-of-arrays layout and check them in one
+// call of CheckCirclePairs.
+//
+// The arrays are reused every frame.
+/////////////////////////////////////////////////////////
+class CirclePairBatch final : public IUncopyable
+{
+public:
+	CirclePairBatch() = default;
+
+	void Clear()
+	{
+		x1_.clear();
+		y1_.clear();
+		r1_.clear();
+		x2_.clear();
+		y2_.clear();
+		r2_.clear();
+	}
+
+	void Push(const Vector2& center1, float radius1, const Vector2& center2, float radius2)
+	{
+		x1_.push_back(center1.x());
+		y1_.push_back(center1.y());
+		r1_.push_back(radius1);
+		x2_.push_back(center2.x());
+		y2_.push_back(center2.y());
+		r2_.push_back(radius2);
+	}
+
+	// Check all pairs pushed since the last Clear.
+	void Check()
+	{
+		hits_.resize((size() + 63) / 64);
+		CheckCirclePairs(x1_.data(), y1_.data(), r1_.data(),
+						 x2_.data(), y2_.data(), r2_.data(),
+						 size(), hits_.data());
+	}
+
+	// Only valid after Check.
+	bool hit(std::size_t i) const
+	{
+		return (hits_[i >> 6] >> (i & 63)) & 1;
+	}
+
+	std::size_t size() const { return x1_.size(); }
+
+private:
+	std::vector<float> x1_;
+	std::vector<float> y1_;
+	std::vector<float> r1_;
+	std::vector<float> x2_;
+	std::vector<float> y2_;
+	std::vector<float> r2_;
+
+	std::vector<uint64_t> hits_;
+};
+
+}
+
+#endif
@@ -1,42 +1,32 @@
 #include "collider.h"
 
+#include <cmath>
+#include <limits>
+
 using namespace ysd_phy_2d;
 
-// Check the detection between 2 polygons by gjk.
-inline bool ysd_phy_2d::DoCheck(const PolygonCollider& collider1, const PolygonCollider& collider2)
+namespace
 {
-	// Initial direction: from collider1's center to collider2's center.
-	Vector2 c1 = collider1.TransformVector(collider1.pshared_shape_->Center());
-	Vector2 c2 = collider2.TransformVector(collider2.pshared_shape_->Center());
-	Vector2 dir = c1 - c2;
-	if (dir == Vector2::kZero)
-	{
-		dir.set_x(1);
-	}
 
-	// Vertices transform from model coordinates to world coordinates.
-	const std::vector<Vector2> verts1 = collider1.pshared_shape_->vertices();
-	std::size_t size1 = verts1.size();
-	Vector2* vert_arr1 = new Vector2[size1];
-	for (std::size_t i = 0; i < size1; ++i)
-	{
-		vert_arr1[i] = collider1.TransformVector(verts1[i]);
-	}
-
-	const std::vector<Vector2> verts2 = collider2.pshared_shape_->vertices();
-	std::size_t size2 = verts2.size();
-	Vector2* vert_arr2 = new Vector2[size2];
-	for (std::size_t i = 0; i < size2; ++i)
-	{
-		vert_arr2[i] = collider2.TransformVector(verts2[i]);
-	}
+// GJK from the given direction.
+// @param[in,out]	dir			The initial direction, the last search
+//								direction when it returns. It separates the
+//								two polygons if they do not collide.
+// @param[out]		iterations	Number of support points computed.
+// @param[out]		triangle	The simplex that contains the origin if they
+//								collide.
+bool Gjk(SupportVertices& support1, SupportVertices& support2, Vector2& dir,
+		 uint32_t& iterations, Vector2* triangle)
+{
+	iterations = 0;
 
 	// Simplex that used to check whether it contain the origin.
 	Vector2 simplex[3];
 	std::size_t index = 0;
 
 	// The first point along the initial direction.
-	simplex[index] = Support(vert_arr1, size1, vert_arr2, size2, dir);
+	simplex[index] = Support(support1, support2, dir);
+	++iterations;
 
 	if (Vector2::Dot(simplex[0], dir) <= 0)
 	{
@@ -48,8 +38,9 @@ inline bool ysd_phy_2d::DoCheck(const PolygonCollider& collider1, const PolygonC
 
 	for (;;)
 	{
-		simplex[++index] = Support(vert_arr1, size1, vert_arr2, size2, dir);
-		if (Vector2::Dot(simplex[0], dir) <= 0)
+		simplex[++index] = Support(support1, support2, dir);
+		++iterations;
+		if (Vector2::Dot(simplex[index], dir) <= 0)
 		{
 			return false;
 		}
@@ -100,140 +91,453 @@ inline bool ysd_phy_2d::DoCheck(const PolygonCollider& collider1, const PolygonC
 			else
 			{
 				// The origin is contained inside the triangle abc.
+				triangle[0] = simplex[0];
+				triangle[1] = simplex[1];
+				triangle[2] = simplex[2];
 				return true;
 			}
 		}
 
 	}
 
-	delete[] vert_arr1;
-	delete[] vert_arr2;
-
 	return false;
 }
 
+// Cross product of two 2d vectors, the z of the 3d one.
+inline float Cross(const Vector2& a, const Vector2& b)
+{
+	return a.x() * b.y() - a.y() * b.x();
+}
+
+// Most points of the polytope in EPA.
+const std::size_t kMaxEpaPoints = 32;
+
+// EPA stops when the polytope grows less than this along the normal.
+const float kEpaTolerance = 1e-4f;
+
+// Expand the triangle of GJK until its edge closest to the origin is on
+// the boundary of the Minkowski difference.
+// @param[out]	normal	Unit normal of the closest edge, from the first
+//						polygon to the second.
+// @param[out]	depth	Distance from the origin to the edge.
+void Epa(SupportVertices& support1, SupportVertices& support2, const Vector2* triangle,
+		 Vector2& normal, float& depth)
+{
+	// The polytope is kept anticlockwise, so (e.y, -e.x) of an edge e
+	// points outward. It is on the stack, EPA never allocates.
+	Vector2 polytope[kMaxEpaPoints];
+	std::size_t count = 3;
+	polytope[0] = triangle[0];
+	polytope[1] = triangle[1];
+	polytope[2] = triangle[2];
+	if (Cross(polytope[1] - polytope[0], polytope[2] - polytope[0]) < 0)
+		std::swap(polytope[1], polytope[2]);
+
+	for (;;)
+	{
+		// Find the edge closest to the origin.
+		std::size_t closest = 0;
+		float distance = std::numeric_limits<float>::max();
+		Vector2 edge_normal(1, 0);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const Vector2& a = polytope[i];
+			const Vector2& b = polytope[i + 1 == count ? 0 : i + 1];
+			float ex = b.x() - a.x(), ey = b.y() - a.y();
+			float length = std::sqrt(ex * ex + ey * ey);
+			if (length == 0)
+				continue;
+
+			Vector2 n(ey / length, -ex / length);
+			float d = Vector2::Dot(n, a);
+			if (d < distance)
+			{
+				distance = d;
+				closest = i;
+				edge_normal = n;
+			}
+		}
+
+		Vector2 point = Support(support1, support2, edge_normal);
+		float extent = Vector2::Dot(point, edge_normal);
+		if (extent - distance < kEpaTolerance || count == kMaxEpaPoints)
+		{
+			normal = edge_normal;
+			depth = distance;
+			return;
+		}
+
+		// Insert the new point between the ends of the closest edge.
+		for (std::size_t i = count; i > closest + 1; --i)
+		{
+			polytope[i] = polytope[i - 1];
+		}
+		polytope[closest + 1] = point;
+		++count;
+	}
+}
+
+// Keep the part of the segment on the negative side of the line
+// dot(normal, p) = offset.
+// @return	Number of points left.
+std::size_t ClipSegment(const Vector2* in, Vector2* out, const Vector2& normal, float offset)
+{
+	std::size_t count = 0;
+	float d0 = Vector2::Dot(normal, in[0]) - offset;
+	float d1 = Vector2::Dot(normal, in[1]) - offset;
+
+	if (d0 <= 0)
+		out[count++] = in[0];
+	if (d1 <= 0)
+		out[count++] = in[1];
+
+	// The ends are on different sides, add the crossing point.
+	if (d0 * d1 < 0)
+		out[count++] = in[0] + (in[1] - in[0]) * (d0 / (d0 - d1));
+
+	return count;
+}
+
+// The edge whose outward normal is the most along the direction.
+std::size_t BestEdge(const PolygonCollider& collider, const Vector2& dir, float& alignment)
+{
+	const std::vector<Vector2>& normals = collider.world_normals();
+	std::size_t best = 0;
+	alignment = Vector2::Dot(normals[0], dir);
+	for (std::size_t i = 1, l = normals.size(); i < l; ++i)
+	{
+		float dot = Vector2::Dot(normals[i], dir);
+		if (dot > alignment)
+		{
+			alignment = dot;
+			best = i;
+		}
+	}
+	return best;
+}
+
+// Find the contact points of two polygons by clipping.
+// The face more facing the other polygon is the reference face, the
+// incident face of the other polygon is clipped by the side planes of
+// the reference face, the points below the reference face are the
+// contact points.
+void ClipContacts(const PolygonCollider& collider1, const PolygonCollider& collider2, Collision* collision)
+{
+	float alignment1, alignment2;
+	std::size_t edge1 = BestEdge(collider1, collision->normal, alignment1);
+	std::size_t edge2 = BestEdge(collider2, -collision->normal, alignment2);
+
+	// Prefer the first polygon on a near tie, so that a resting contact
+	// does not flip between the faces.
+	bool flip = alignment2 > alignment1 * 0.98f + 0.001f;
+	const PolygonCollider& reference = flip ? collider2 : collider1;
+	const PolygonCollider& incident = flip ? collider1 : collider2;
+	std::size_t ref_edge = flip ? edge2 : edge1;
+	std::size_t inc_edge = flip ? edge1 : edge2;
+
+	const float* rxs = reference.world_xs();
+	const float* rys = reference.world_ys();
+	std::size_t rnext = ref_edge + 1 == reference.vertex_count() ? 0 : ref_edge + 1;
+	Vector2 v1(rxs[ref_edge], rys[ref_edge]);
+	Vector2 v2(rxs[rnext], rys[rnext]);
+
+	const float* ixs = incident.world_xs();
+	const float* iys = incident.world_ys();
+	std::size_t inext = inc_edge + 1 == incident.vertex_count() ? 0 : inc_edge + 1;
+	Vector2 points[2] = { Vector2(ixs[inc_edge], iys[inc_edge]), Vector2(ixs[inext], iys[inext]) };
+
+	// Clip by the two side planes of the reference face.
+	Vector2 tangent = v2 - v1;
+	tangent.Normalize();
+	Vector2 clipped1[3];
+	Vector2 clipped2[3];
+	std::size_t count = ClipSegment(points, clipped1, -tangent, -Vector2::Dot(tangent, v1));
+	if (count >= 2)
+		count = ClipSegment(clipped1, clipped2, tangent, Vector2::Dot(tangent, v2));
+
+	collision->point_count = 0;
+	if (count >= 2)
+	{
+		// Keep the points below the reference face.
+		const Vector2& face_normal = reference.world_normals()[ref_edge];
+		float face = Vector2::Dot(face_normal, v1);
+		for (std::size_t i = 0; i < 2; ++i)
+		{
+			if (Vector2::Dot(face_normal, clipped2[i]) - face <= kEpaTolerance)
+			{
+				collision->points[collision->point_count++] = clipped2[i];
+			}
+		}
+	}
+
+	if (collision->point_count == 0)
+	{
+		// Numerical corner case, use the deepest point of the second polygon.
+		std::size_t deepest = IndexOfFurthestPoint(collider2.world_xs(), collider2.world_ys(),
+												   collider2.vertex_count(), -collision->normal);
+		collision->points[0] = Vector2(collider2.world_xs()[deepest], collider2.world_ys()[deepest]);
+		collision->point_count = 1;
+	}
+}
+
+}
+
+// Check the detection between 2 polygons by gjk.
+bool ysd_phy_2d::DoCheck(const PolygonCollider& collider1, const PolygonCollider& collider2,
+						 GjkWarmStart* warm, Collision* collision)
+{
+	// The cached data is from the view of the collider with the lower id.
+	if (warm != nullptr && collider1.id() > collider2.id())
+	{
+		bool collided = DoCheck(collider2, collider1, warm, collision);
+		if (collided && collision != nullptr)
+			collision->Flip();
+		return collided;
+	}
+
+	// Vertices in world space, as structure of arrays for the support function.
+	SupportVertices support1 = { collider1.world_xs(), collider1.world_ys(), collider1.vertex_count(), 0 };
+	SupportVertices support2 = { collider2.world_xs(), collider2.world_ys(), collider2.vertex_count(), 0 };
+
+	Vector2 dir;
+	if (warm != nullptr && warm->valid)
+	{
+		// Start from the last frame. If the pair is still separated by the
+		// same direction, the first support point proves it.
+		dir = warm->dir;
+		support1.last = warm->support1 < support1.size ? warm->support1 : 0;
+		support2.last = warm->support2 < support2.size ? warm->support2 : 0;
+	}
+	else
+	{
+		// Initial direction: from collider1's center to collider2's center.
+		Vector2 c1 = collider1.TransformVector(collider1.pshared_shape_->Center());
+		Vector2 c2 = collider2.TransformVector(collider2.pshared_shape_->Center());
+		dir = c1 - c2;
+	}
+	if (dir == Vector2::kZero)
+	{
+		dir.set_x(1);
+	}
+
+	uint32_t iterations;
+	Vector2 triangle[3];
+	bool collided = Gjk(support1, support2, dir, iterations, triangle);
+
+	if (warm != nullptr)
+	{
+		warm->valid = true;
+		warm->dir = dir;
+		warm->support1 = static_cast<uint32_t>(support1.last);
+		warm->support2 = static_cast<uint32_t>(support2.last);
+		warm->iterations = iterations;
+	}
+
+	if (collided && collision != nullptr)
+	{
+		collision->first = collider1.id();
+		collision->second = collider2.id();
+		Epa(support1, support2, triangle, collision->normal, collision->depth);
+		ClipContacts(collider1, collider2, collision);
+	}
+	return collided;
+}
+
 // Check the detection between a circle and a polygon.
-inline bool ysd_phy_2d::DoCheck(const CircleCollider& collider1, const PolygonCollider& collider2)
+bool ysd_phy_2d::DoCheck(const CircleCollider& collider1, const PolygonCollider& collider2, Collision* collision)
 {
 	Vector2 center = collider1.Center();
-	// Two collider contact just need that one corner of the polygon is in the circle.
-	const std::vector<Vector2> corners = collider2.pshared_shape_->vertices();
-	for (const Vector2& corner : corners)
+	float radius = collider1.Radius();
+	const float* xs = collider2.world_xs();
+	const float* ys = collider2.world_ys();
+	const std::vector<Vector2>& normals = collider2.world_normals();
+	const std::size_t count = collider2.vertex_count();
+
+	// Find the edge the center is the furthest out of.
+	std::size_t edge = 0;
+	float separation = -std::numeric_limits<float>::max();
+	for (std::size_t i = 0; i < count; ++i)
 	{
-		float distance = Vector2::Distance(corner, center);
-		if (distance < collider1.Radius())
-			return true;
+		float s = normals[i].x() * (center.x() - xs[i]) + normals[i].y() * (center.y() - ys[i]);
+		if (s >= radius)
+			return false;
+		if (s > separation)
+		{
+			separation = s;
+			edge = i;
+		}
 	}
-	return false;
+
+	// Closest point of the polygon to the center, and the normal from the
+	// polygon to the circle.
+	std::size_t next = edge + 1 == count ? 0 : edge + 1;
+	Vector2 v1(xs[edge], ys[edge]);
+	Vector2 v2(xs[next], ys[next]);
+	Vector2 closest;
+	Vector2 normal;
+	float distance;
+	if (separation <= 0)
+	{
+		// The center is inside the polygon.
+		normal = normals[edge];
+		closest = center - normal * separation;
+		distance = separation;
+	}
+	else if (Vector2::Dot(center - v1, v2 - v1) <= 0)
+	{
+		// Closest to the first corner of the edge.
+		if (Vector2::SqrDistance(center, v1) >= radius * radius)
+			return false;
+		closest = v1;
+		normal = center - v1;
+		distance = normal.length();
+		normal /= distance;
+	}
+	else if (Vector2::Dot(center - v2, v1 - v2) <= 0)
+	{
+		// Closest to the second corner of the edge.
+		if (Vector2::SqrDistance(center, v2) >= radius * radius)
+			return false;
+		closest = v2;
+		normal = center - v2;
+		distance = normal.length();
+		normal /= distance;
+	}
+	else
+	{
+		// Closest to the edge.
+		normal = normals[edge];
+		closest = center - normal * separation;
+		distance = separation;
+	}
+
+	if (collision != nullptr)
+	{
+		collision->first = collider1.id();
+		collision->second = collider2.id();
+		collision->normal = -normal;
+		collision->depth = radius - distance;
+		collision->points[0] = closest;
+		collision->point_count = 1;
+	}
+	return true;
+}
+
+void ysd_phy_2d::CircleContact(const Vector2& center1, float radius1,
+							   const Vector2& center2, float radius2,
+							   Collision* collision)
+{
+	Vector2 offset = center2 - center1;
+	float distance = std::sqrt(Vector2::Dot(offset, offset));
+	if (distance > 0)
+		collision->normal = Vector2(offset.x() / distance, offset.y() / distance);
+	else
+		collision->normal = Vector2(1, 0);
+
+	// The contact point is in the middle of the overlap.
+	collision->depth = radius1 + radius2 - distance;
+	collision->points[0] = center1 + collision->normal * (radius1 - collision->depth / 2);
+	collision->point_count = 1;
 }
 
 // Check the detection between two circle colliders.
-inline bool ysd_phy_2d::DoCheck(const CircleCollider& collider1, const CircleCollider& collider2)
+bool ysd_phy_2d::DoCheck(const CircleCollider& collider1, const CircleCollider& collider2, Collision* collision)
 {
 	// Just need to check if the distance of two circle is smaller than the sum of their radius.
-	Vector2 c1 = collider1.Center();
-	Vector2 c2 = collider2.Center();
-	float distance = Vector2::Distance(c1, c2);
-	return distance < collider1.Radius() + collider2.Radius();
+	// Compare the squares to avoid the square root.
+	float radius = collider1.Radius() + collider2.Radius();
+	if (Vector2::SqrDistance(collider1.Center(), collider2.Center()) >= radius * radius)
+		return false;
+
+	if (collision != nullptr)
+	{
+		collision->first = collider1.id();
+		collision->second = collider2.id();
+		CircleContact(collider1.Center(), collider1.Radius(), collider2.Center(), collider2.Radius(), collision);
+	}
+	return true;
 }
 
-inline const Vector2& PolygonCollider::TransformVector(const Vector2& vec) const
+Vector2 PolygonCollider::TransformVector(const Vector2& vec) const
 {
-	Vector2 v;
-
 	// Scale
 	float x = vec.x() * scale_.x();
 	float y = vec.y() * scale_.y();
 
 	// Rotate. [x*cosA-y*sinA  x*sinA+y*cosA]
-	x = x * cosf(angle_) - y * sinf(angle_);
-	y = y * sinf(angle_) + y * cosf(angle_);
+	float rx = x * cos_ - y * sin_;
+	float ry = x * sin_ + y * cos_;
 
 	// Move
-	x += position_.x();
-	y += position_.y();
-
-	return v;
-
+	return Vector2(rx + position_.x(), ry + position_.y());
 }
 
-void PolygonCollider::ResetBound(bool transformed) const
+void PolygonCollider::TransformVertices() const
 {
-	float xmin, xmax, ymin, ymax;
 	const std::vector<Vector2>& verts = pshared_shape_->vertices();
 	std::size_t count = verts.size();
-	std::size_t ini = 0;
-	Vector2 p0;
-	Vector2 p1;
+	world_xy_.resize(count * 2);
 
-	// Initialize.
-	if (count % 2 == 0)
+	float* xs = world_xy_.data();
+	float* ys = xs + count;
+	const float px = position_.x(), py = position_.y();
+	const float sx = scale_.x(), sy = scale_.y();
+	for (std::size_t i = 0; i < count; ++i)
 	{
-		ini = 2;
+		float x = verts[i].x() * sx;
+		float y = verts[i].y() * sy;
+		xs[i] = x * cos_ - y * sin_ + px;
+		ys[i] = x * sin_ + y * cos_ + py;
+	}
+	vertices_changed_ = false;
+}
 
-		if (transformed)
-		{
-			p0 = TransformVector(verts[0]);
-			p1 = TransformVector(verts[1]);
-		}
-		else
-		{
-			p0 = verts[0];
-			p1 = verts[1];
-		}
+void PolygonCollider::UpdateNormals() const
+{
+	if (!normals_changed_)
+		return;
 
-		xmin = std::min(p0.x(), p1.x());
-		xmax = std::max(p0.x(), p1.x());
+	const float* xs = world_xs();
+	const float* ys = world_ys();
+	std::size_t count = vertex_count();
 
-		ymin = std::min(p0.y(), p1.y());
-		ymax = std::max(p0.y(), p1.y());
+	// Twice the signed area, positive if the vertices are anticlockwise.
+	float area = 0;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		std::size_t j = i + 1 == count ? 0 : i + 1;
+		area += xs[i] * ys[j] - xs[j] * ys[i];
 	}
-	else
+	float side = area >= 0 ? 1.0f : -1.0f;
+
+	world_normals_.resize(count);
+	for (std::size_t i = 0; i < count; ++i)
 	{
-		ini = 1;
+		std::size_t j = i + 1 == count ? 0 : i + 1;
+		Vector2 normal((ys[j] - ys[i]) * side, (xs[i] - xs[j]) * side);
+		world_normals_[i] = normal.Normalize();
+	}
+	normals_changed_ = false;
+}
 
-		if (transformed)
-			p0 = TransformVector(verts[0]);
-		else
-			p0 = verts[0];
+void PolygonCollider::ResetBound() const
+{
+	TransformVertices();
+	normals_changed_ = true;
 
-		xmin = xmax = p0.x();
-		ymin = ymax = p0.y();
-	}
+	const float* xs = world_xy_.data();
+	const float* ys = xs + vertex_count();
+	float xmin = xs[0], xmax = xs[0], ymin = ys[0], ymax = ys[0];
 
 	// Find the bound points.
-	for (std::size_t i = ini; i < count; i += 2)
+	for (std::size_t i = 1, l = vertex_count(); i < l; ++i)
 	{
-		if (transformed)
-		{
-			p0 = TransformVector(verts[ini]);
-			p1 = TransformVector(verts[ini + 1]);
-		}
-		else
-		{
-			p0 = verts[ini];
-			p1 = verts[ini + 1];
-		}
-
-		float xb = p1.x(), xs = p0.x(), yb = p1.y(), ys = p0.y();
-		if (xb < xs)
-		{
-			xb = p0.x();
-			xs = p1.x();
-		}
-		if (yb < ys)
-		{
-			yb = p0.y();
-			ys = p1.y();
-		}
-
-		xmin = std::min(xmin, xs);
-		xmax = std::max(xmax, xb);
-		ymin = std::min(ymin, ys);
-		ymax = std::max(ymax, yb);
+		xmin = std::min(xmin, xs[i]);
+		xmax = std::max(xmax, xs[i]);
+		ymin = std::min(ymin, ys[i]);
+		ymax = std::max(ymax, ys[i]);
 	}
 
 	bound_.min = Vector2(xmin, ymin);
 	bound_.max = Vector2(xmax, ymax);
-
 }
@@ -7,6 +7,7 @@
 #define _COLLIDER_H_
 
 #include <memory>
+#include <vector>
 #include <algorithm>
 #include <functional>
 
@@ -14,6 +15,7 @@
 #include "../math/bound.h"
 #include "../common/un-copy-move-interface.h"
 #include "shapes.h"
+#include "support.h"
 #include "collision.h"
 
 namespace ysd_phy_2d
@@ -24,50 +26,58 @@ class BaseCollider;
 class CircleCollider;
 class PolygonCollider;
 
-// Get the furthest point along the certain direction.
-inline std::size_t IndexOfFurthestPoint(const Vector2* vertices,
-										const std::size_t size,
-										const Vector2& dir)
-{
-	std::size_t fi = 0;
-	// Dot product of two vectors.
-	float fdot = Vector2::Dot(dir, vertices[0]);
-	for (std::size_t i = 1; i < size; ++i)
-	{
-		float dot = Vector2::Dot(dir, vertices[i]);
-		if (dot > fdot)
-		{
-			fdot = dot;
-			fi = i;
-		}
-	}
-	return fi;
-}
+// Narrow phase detection.
+// Every DoCheck fills the collision with the contact data if it is not
+// null and the colliders collide.
 
-// Minkowski sum support function for GJK.
-inline Vector2 Support(const Vector2* vertices1,
-					   const std::size_t size1,
-					   const Vector2* vertices2,
-					   const std::size_t size2,
-					   const Vector2& dir)
+// Check if two circle collide each other.
+bool DoCheck(const CircleCollider& collider1, const CircleCollider& collider2, Collision* collision = nullptr);
+
+// Contact of two colliding circles in closed form. The ids are not set.
+void CircleContact(const Vector2& center1, float radius1,
+				   const Vector2& center2, float radius2,
+				   Collision* collision);
+
+// What GJK learned about a pair of polygons in the last frame, to start
+// the next run from. The data is from the view of the collider with the
+// lower id.
+struct GjkWarmStart
 {
-	std::size_t i = IndexOfFurthestPoint(vertices1, size1, dir);
-	std::size_t j = IndexOfFurthestPoint(vertices2, size2, -dir);
-	return vertices1[i] - vertices2[j];
-}
+	// The last search direction. It separates the pair if they did not
+	// collide.
+	Vector2 dir;
 
-// Narrow phase detection.
-// Check if two circle collide each other.
-bool DoCheck(const CircleCollider& collider1, const CircleCollider& collider2);
+	// Support points of the two colliders in the last simplex.
+	uint32_t support1 = 0;
+	uint32_t support2 = 0;
+
+	// Support points computed by the last run.
+	uint32_t iterations = 0;
+
+	bool valid = false;
+};
 
 // Use GJK algorithm to check if two convex polygon collide each other.
-bool DoCheck(const PolygonCollider& collider1, const PolygonCollider& collider2);
+// The contact is found by EPA from the last simplex of GJK, and the
+// contact points by clipping the incident edge against the reference one.
+// @param[in,out]	warm	Start from the last frame and keep this frame's
+//							result for the next. Can be null.
+bool DoCheck(const PolygonCollider& collider1, const PolygonCollider& collider2,
+			 GjkWarmStart* warm = nullptr, Collision* collision = nullptr);
 
 // Check if a convex polygon collide circle.
-bool DoCheck(const CircleCollider& collider1, const PolygonCollider& collider2);
+bool DoCheck(const CircleCollider& collider1, const PolygonCollider& collider2, Collision* collision = nullptr);
+
+// Kinds of the colliders.
+enum ColliderType
+{
+	kCircleColliderType = 0,
+	kPolygonColliderType = 1
+};
 
 // Callback when collision is detected.
-typedef std::function<void(std::shared_ptr<Collision>)> OnDetectedCallback;
+// The collision is only valid until the next frame.
+typedef std::function<void(const Collision&)> OnDetectedCallback;
 enum OnDetectedCallbackType
 {
 	kOnColliderEnter = 1,
@@ -108,8 +118,16 @@ public:
 
 	uint16_t id() const { return id_; }
 
+	virtual ColliderType type() const = 0;
+
 	virtual const Bound& bound() const { return bound_; }
 
+	const Vector2& position() const { return position_; }
+	const Vector2& scale() const { return scale_; }
+
+	// Only a polygon collider can rotate.
+	virtual float angle() const { return 0; }
+
 	virtual void Translate(const Vector2& movement)
 	{
 		position_ += movement;
@@ -123,8 +141,8 @@ public:
 		scale_.Scale(scale);
 
 		// Update the bound.
-		Vector2 center = (bound_.max - bound_.min) / 2;
-		Vector2 offset = center - bound_.min;
+		Vector2 center = (bound_.max + bound_.min) / 2;
+		Vector2 offset = bound_.max - center;
 		offset.Scale(scale);
 		bound_.min = center - offset;
 		bound_.max = center + offset;
@@ -135,10 +153,14 @@ public:
 		// Do nothing.
 	}
 
+	// Set the transform in world space instead of changing it by a delta.
+	// The bound is updated once for the whole transform.
+	virtual void SetTransform(const Vector2& position, float angle, const Vector2& scale) = 0;
+
 	// Transform a vector/point from shape's self space to world space.
 	// We must to transform the collider first in narrow phase.
 	// @return 	The transformed vector/point.
-	virtual const Vector2& TransformVector(const Vector2& vec) const = 0;
+	virtual Vector2 TransformVector(const Vector2& vec) const = 0;
 
 	// Overload functions to check if two BaseCollider contact.
 	virtual bool Check(const BaseCollider&, OnDetectedCallback* callbacks) const = 0;
@@ -158,7 +180,7 @@ protected:
 };
 
 // Is two colliders the same one.
-const bool operator== (const BaseCollider& vec1, const BaseCollider& vec2)
+inline const bool operator== (const BaseCollider& vec1, const BaseCollider& vec2)
 {
 	return vec1.id() == vec2.id();
 }
@@ -172,7 +194,7 @@ const bool operator== (const BaseCollider& vec1, const BaseCollider& vec2)
 class CircleCollider : public BaseCollider
 {
 public:
-	CircleCollider(uint8_t id, std::shared_ptr<Circle> c)
+	CircleCollider(uint16_t id, std::shared_ptr<Circle> c)
 		: BaseCollider(id), pshared_shape_(c)
 	{
 		// Initailize bound.
@@ -181,16 +203,33 @@ public:
 		bound_.max = v;
 	}
 
+	ColliderType type() const override { return kCircleColliderType; }
+
 	void ScaleFor(const Vector2& scale) override
 	{
 		// Only need x.
 		scale_.set_x(scale.x());
 
-		// TODO(ysd): Optimize scaling of a circle.
+		// The bound follows the new radius.
+		Vector2 v = Vector2(Radius(), Radius());
+		bound_.min = position_ - v;
+		bound_.max = position_ + v;
+	}
+
+	// A circle can not rotate, the angle is ignored. Only x of the scale
+	// is used.
+	void SetTransform(const Vector2& position, float /*angle*/, const Vector2& scale) override
+	{
+		position_ = position;
+		scale_.set_x(scale.x());
+
+		Vector2 v = Vector2(Radius(), Radius());
+		bound_.min = position_ - v;
+		bound_.max = position_ + v;
 	}
 
 	// A circle do not have rotation and scale.
-	const Vector2& TransformVector(const Vector2& vec) const override
+	Vector2 TransformVector(const Vector2& vec) const override
 	{
 		return vec + position_;
 	}
@@ -208,15 +247,15 @@ public:
 	// Overload functions to check if two BaseCollider contact.
 	bool Check(const BaseCollider& other, OnDetectedCallback* callback) const override
 	{
-		other.Check(*this, callback);
+		return other.Check(*this, callback);
 	}
 	bool Check(const CircleCollider& other, OnDetectedCallback* callback) const override
 	{
-		DoCheck(*this, other);
+		return DoCheck(*this, other);
 	}
 	bool Check(const PolygonCollider& other, OnDetectedCallback* callback) const override
 	{
-		DoCheck(*this, other);
+		return DoCheck(*this, other);
 	}
 
 protected:
@@ -224,8 +263,7 @@ protected:
 
 private:
 	// Do the collistion detection.
-	friend bool DoCheck(const CircleCollider& collider1, const CircleCollider& collider2);
-	friend bool DoCheck(const CircleCollider& collider1, const CircleCollider& collider2);
+	friend bool DoCheck(const CircleCollider& collider1, const CircleCollider& collider2, Collision* collision);
 
 };
 
@@ -236,38 +274,102 @@ private:
 class PolygonCollider : public BaseCollider
 {
 public:
-	PolygonCollider(uint8_t id, std::shared_ptr<ConvexPolygon> pss)
-		: BaseCollider(id), pshared_shape_(pss), angle_(0)
+	PolygonCollider(uint16_t id, std::shared_ptr<ConvexPolygon> pss)
+		: BaseCollider(id), pshared_shape_(pss), angle_(0), cos_(1), sin_(0)
 	{
 		// Initailize bound.
-		ResetBound(false);
+		ResetBound();
 	}
 
+	ColliderType type() const override { return kPolygonColliderType; }
+
 	// The generic DoCheck function is not friend.
 	// template <typename CT1, typename CT2>
 	// friend bool DoCheck(const CT1& collider1, const CT2& collider2);
 
+	// Only the bound is moved, the vertices are moved when they are used.
+	void Translate(const Vector2& movement) override
+	{
+		BaseCollider::Translate(movement);
+		vertices_changed_ = true;
+	}
+
+	void ScaleFor(const Vector2& scale) override
+	{
+		scale_.Scale(scale);
+		ResetBound();
+	}
+
 	// Rotate the collider anticlockwise by given angle.
 	void Rotate(float angle) override
 	{
 		angle_ += angle;
+		cos_ = cosf(angle_);
+		sin_ = sinf(angle_);
 		ResetBound();
 	}
 
-	const Vector2& TransformVector(const Vector2& vec) const override;
+	float angle() const override { return angle_; }
+
+	void SetTransform(const Vector2& position, float angle, const Vector2& scale) override
+	{
+		position_ = position;
+		angle_ = angle;
+		cos_ = cosf(angle_);
+		sin_ = sinf(angle_);
+		scale_ = scale;
+		ResetBound();
+	}
+
+	Vector2 TransformVector(const Vector2& vec) const override;
+
+	// Vertices in world space as structure of arrays, in the order of the
+	// shape's vertices. They are transformed once after the collider
+	// moved, rotated or scaled, no matter how many pairs use them.
+	const float* world_xs() const
+	{
+		UpdateVertices();
+		return world_xy_.data();
+	}
+
+	const float* world_ys() const
+	{
+		UpdateVertices();
+		return world_xy_.data() + vertex_count();
+	}
+
+	std::size_t vertex_count() const { return pshared_shape_->vertices().size(); }
+
+	// Unit outward normals of the edges in world space. The ith edge is
+	// from the ith vertex to the next one.
+	const std::vector<Vector2>& world_normals() const
+	{
+		UpdateNormals();
+		return world_normals_;
+	}
+
+	// Bring the world space vertices, the normals and the shape's center
+	// up to date. After that the collider is only read by narrow phase,
+	// so many threads can check it at the same time.
+	void UpdateCaches() const
+	{
+		UpdateVertices();
+		UpdateNormals();
+		pshared_shape_->Center();
+	}
 
 	// Overload functions to check if two BaseCollider contact.
 	bool Check(const BaseCollider& other, OnDetectedCallback* callback) const override
 	{
-		other.Check(*this, callback);
+		return other.Check(*this, callback);
 	}
 	bool Check(const CircleCollider& other, OnDetectedCallback* callback) const override
 	{
-		DoCheck(other, *this);
+		return DoCheck(other, *this);
 	}
 	bool Check(const PolygonCollider& other, OnDetectedCallback* callback) const override
 	{
-		DoCheck(*this, other);
+		return DoCheck(*this, other);
 	}
 
 protected:
@@ -276,12 +378,37 @@ protected:
 	// Transform.
 	float angle_;
 
+	// Cached cos and sin of the angle.
+	float cos_;
+	float sin_;
+
 private:
-	void ResetBound(bool transformed = true) const;
+	// Transform the vertices and fit the bound around them.
+	void ResetBound() const;
+
+	// Transform the vertices if the collider has moved since.
+	void UpdateVertices() const
+	{
+		if (vertices_changed_)
+			TransformVertices();
+	}
+
+	void TransformVertices() const;
+
+	void UpdateNormals() const;
+
+	// World space vertices, x of all vertices then y of all vertices.
+	mutable std::vector<float> world_xy_;
+	mutable bool vertices_changed_ = true;
+
+	// World space edge normals. Only rotation and scale change them.
+	mutable std::vector<Vector2> world_normals_;
+	mutable bool normals_changed_ = true;
 
 	// Only the PolygonCollider overload will be friend
-	friend bool DoCheck(const CircleCollider& collider1, const PolygonCollider& collider2);
-	friend bool DoCheck(const PolygonCollider& collider1, const PolygonCollider& collider2);
+	friend bool DoCheck(const CircleCollider& collider1, const PolygonCollider& collider2, Collision* collision);
+	friend bool DoCheck(const PolygonCollider& collider1, const PolygonCollider& collider2,
+						GjkWarmStart* warm, Collision* collision);
 };
 
 }
@@ -1,10 +1,114 @@
+//////////////////////////////////////////////////////
+// @fileoverview Contact data of two colliders.
+// @author	ysd
+//////////////////////////////////////////////////////
+
 #ifndef _COLLISION_H_
 #define _COLLISION_H_
 
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+#include "../math/vector_2.h"
+#include "../common/un-copy-move-interface.h"
+
 namespace ysd_phy_2d
 {
-	class Collision
-	{};
+
+//////////////////////////////////////////////////////
+// A Collision describe how two colliders contact.
+//
+// The normal is a unit vector from the first collider
+// to the second one, moving the second collider by
+// normal * depth separates them.
+//////////////////////////////////////////////////////
+class Collision
+{
+public:
+	// Swap the two colliders.
+	void Flip()
+	{
+		std::swap(first, second);
+		normal = -normal;
+	}
+
+	// Ids of the two colliders.
+	uint16_t first = 0;
+	uint16_t second = 0;
+
+	Vector2 normal;
+
+	// Penetration depth along the normal.
+	float depth = 0;
+
+	// Contact points in world space.
+	Vector2 points[2];
+	uint8_t point_count = 0;
+
+	// Fraction of the step when a continuous collider first touches the
+	// other one. Contacts found at the end of the step have 1.
+	float time_of_impact = 1;
+};
+
+/////////////////////////////////////////////////////////
+// A CollisionBuffer hold the collisions of one frame.
+//
+// Like the PairBuffer, it is reused every frame and does
+// not allocate after it reach the working size of the
+// scene. A collision stay valid until the buffer is
+// cleared by the next frame.
+/////////////////////////////////////////////////////////
+class CollisionBuffer final : public IUncopyable
+{
+public:
+	static const std::size_t kDefaultCapacity = 1 << 14;
+
+	explicit CollisionBuffer(std::size_t capacity = kDefaultCapacity)
+	{
+		collisions_.reserve(capacity);
+	}
+
+	void Clear()
+	{
+		collisions_.clear();
+	}
+
+	// Add an empty collision at the end.
+	Collision& Push()
+	{
+		collisions_.emplace_back();
+		return collisions_.back();
+	}
+
+	// Drop the last collision, e.g. when the pair did not collide.
+	void Pop()
+	{
+		collisions_.pop_back();
+	}
+
+	// Copy the collisions of another buffer to the end.
+	void Append(const Collision* begin, const Collision* end)
+	{
+		collisions_.insert(collisions_.end(), begin, end);
+	}
+
+	std::size_t size() const { return collisions_.size(); }
+	bool empty() const { return collisions_.empty(); }
+
+	const Collision& operator[](std::size_t i) const
+	{
+		return collisions_[i];
+	}
+
+	const Collision* begin() const { return collisions_.data(); }
+	const Collision* end() const { return collisions_.data() + collisions_.size(); }
+
+private:
+	std::vector<Collision> collisions_;
+};
+
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,55 @@
+#include "distance.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace ysd_phy_2d;
+
+float ysd_phy_2d::Distance(const CircleCollider& collider, const Vector2& point)
+{
+	return std::max(Vector2::Distance(point, collider.Center()) - collider.Radius(), 0.0f);
+}
+
+float ysd_phy_2d::Distance(const PolygonCollider& collider, const Vector2& point)
+{
+	const float* xs = collider.world_xs();
+	const float* ys = collider.world_ys();
+	const std::vector<Vector2>& normals = collider.world_normals();
+	const std::size_t count = normals.size();
+
+	// The point is inside if it is behind all edges.
+	bool inside = true;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (normals[i].x() * (point.x() - xs[i]) + normals[i].y() * (point.y() - ys[i]) > 0)
+		{
+			inside = false;
+			break;
+		}
+	}
+	if (inside)
+		return 0;
+
+	// Otherwise the closest point is on one of the edges.
+	float best = std::numeric_limits<float>::max();
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		std::size_t j = i + 1 == count ? 0 : i + 1;
+		Vector2 a(xs[i], ys[i]);
+		Vector2 edge = Vector2(xs[j], ys[j]) - a;
+		Vector2 to_point = point - a;
+
+		float length = Vector2::Dot(edge, edge);
+		float t = length > 0 ? Vector2::Dot(to_point, edge) / length : 0;
+		t = std::min(std::max(t, 0.0f), 1.0f);
+		best = std::min(best, Vector2::SqrDistance(point, a + edge * t));
+	}
+	return std::sqrt(best);
+}
+
+float ysd_phy_2d::Distance(const BaseCollider& collider, const Vector2& point)
+{
+	if (collider.type() == kCircleColliderType)
+		return Distance(static_cast<const CircleCollider&>(collider), point);
+	return Distance(static_cast<const PolygonCollider&>(collider), point);
+}
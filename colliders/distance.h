@@ -0,0 +1,39 @@
+//////////////////////////////////////////////////////
+// @fileoverview Distances from a point to the
+//				 colliders.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#ifndef _DISTANCE_H_
+#define _DISTANCE_H_
+
+#include <algorithm>
+
+#include "../math/vector_2.h"
+#include "../math/bound.h"
+#include "collider.h"
+
+namespace ysd_phy_2d
+{
+
+// Distance from a point to the shape of a collider in world space, zero
+// if the point is inside.
+float Distance(const CircleCollider& collider, const Vector2& point);
+
+// Caches the world data of the polygon if it moved, see
+// PolygonCollider::UpdateCaches.
+float Distance(const PolygonCollider& collider, const Vector2& point);
+
+float Distance(const BaseCollider& collider, const Vector2& point);
+
+// Squared distance from a point to a bound, zero if the point is inside.
+inline float SqrDistance(const Bound& bound, const Vector2& point)
+{
+	float dx = std::max(std::max(bound.min.x() - point.x(), point.x() - bound.max.x()), 0.0f);
+	float dy = std::max(std::max(bound.min.y() - point.y(), point.y() - bound.max.y()), 0.0f);
+	return dx * dx + dy * dy;
+}
+
+}
+
+#endif
@@ -0,0 +1,124 @@
+#include "gjk-cache.h"
+
+using namespace ysd_phy_2d;
+
+const uint32_t GjkCache::kNoEntry;
+const uint32_t GjkCache::kEmptyKey;
+
+GjkCache::GjkCache(std::size_t capacity)
+{
+	// Keep the table at most half full.
+	std::size_t size = 64;
+	while (size < capacity * 2)
+		size *= 2;
+
+	slots_.assign(size, Slot{ kEmptyKey, kNoEntry });
+	mask_ = static_cast<uint32_t>(size - 1);
+	entries_.reserve(capacity);
+}
+
+uint32_t GjkCache::Get(uint16_t id1, uint16_t id2)
+{
+	uint32_t key = Key(id1, id2);
+	uint32_t slot = Home(key);
+	for (;;)
+	{
+		const Slot& entry = slots_[slot];
+		if (entry.key == key)
+		{
+			entries_[entry.entry].frame = frame_;
+			return entry.entry;
+		}
+
+		if (entry.key == kEmptyKey)
+			break;
+
+		slot = (slot + 1) & mask_;
+	}
+
+	if ((entries_.size() + 1) * 2 > slots_.size())
+	{
+		Grow();
+		return Get(id1, id2);
+	}
+
+	uint32_t index = static_cast<uint32_t>(entries_.size());
+	slots_[slot] = Slot{ key, index };
+	entries_.push_back(Entry{ GjkWarmStart(), key, frame_, slot });
+	return index;
+}
+
+void GjkCache::EndFrame(uint32_t max_age)
+{
+	for (std::size_t i = 0; i < entries_.size();)
+	{
+		// The last entry is moved to i, check it next.
+		if (frame_ - entries_[i].frame >= max_age)
+			Erase(static_cast<uint32_t>(i));
+		else
+			++i;
+	}
+	++frame_;
+}
+
+void GjkCache::Clear()
+{
+	for (const Entry& entry : entries_)
+	{
+		slots_[entry.slot] = Slot{ kEmptyKey, kNoEntry };
+	}
+	entries_.clear();
+}
+
+void GjkCache::Erase(uint32_t entry)
+{
+	uint32_t slot = entries_[entry].slot;
+
+	// Move the last entry into the place of the erased one.
+	uint32_t last = static_cast<uint32_t>(entries_.size() - 1);
+	if (entry != last)
+	{
+		entries_[entry] = entries_[last];
+		slots_[entries_[entry].slot].entry = entry;
+	}
+	entries_.pop_back();
+
+	// Shift back the following slots that can not be found without
+	// passing the hole.
+	uint32_t hole = slot;
+	uint32_t next = slot;
+	for (;;)
+	{
+		next = (next + 1) & mask_;
+		const Slot& moved = slots_[next];
+		if (moved.key == kEmptyKey)
+			break;
+
+		// The slot stays if its home is cyclically in (hole, next].
+		uint32_t home = Home(moved.key);
+		bool stays = hole <= next ? (home > hole && home <= next) : (home > hole || home <= next);
+		if (stays)
+			continue;
+
+		slots_[hole] = moved;
+		entries_[moved.entry].slot = hole;
+		hole = next;
+	}
+	slots_[hole] = Slot{ kEmptyKey, kNoEntry };
+}
+
+void GjkCache::Grow()
+{
+	slots_.assign(slots_.size() * 2, Slot{ kEmptyKey, kNoEntry });
+	mask_ = static_cast<uint32_t>(slots_.size() - 1);
+
+	for (uint32_t i = 0, l = static_cast<uint32_t>(entries_.size()); i < l; ++i)
+	{
+		uint32_t slot = Home(entries_[i].key);
+		while (slots_[slot].key != kEmptyKey)
+			slot = (slot + 1) & mask_;
+
+		slots_[slot] = Slot{ entries_[i].key, i };
+		entries_[i].slot = slot;
+	}
+}
@@ -0,0 +1,115 @@
+//////////////////////////////////////////////////////
+// @fileoverview Cache of GJK results across frames.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#ifndef _GJK_CACHE_H_
+#define _GJK_CACHE_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+#include "../common/un-copy-move-interface.h"
+#include "collider.h"
+
+namespace ysd_phy_2d
+{
+
+/////////////////////////////////////////////////////////
+// A GjkCache keep a GjkWarmStart for every pair of
+// polygons checked recently, keyed by the ids of the
+// two colliders.
+//
+// Most pairs move little between frames, a pair that is
+// still separated by last frame's direction is rejected
+// by the first support point.
+//
+// An entry not used for some frames is evicted.
+//
+// Like the ContactTable, the keys are in an open
+// addressing table with linear probing and backshift
+// erase, and the entries are stored densely so eviction
+// is one pass over the live entries. Neither allocates
+// once the cache reach the working size of the scene.
+/////////////////////////////////////////////////////////
+class GjkCache final : public IUncopyable
+{
+public:
+	// Index of no entry.
+	static const uint32_t kNoEntry = 0xffffffff;
+
+	// @param[in]	capacity	Pairs the cache holds without growing.
+	explicit GjkCache(std::size_t capacity = 1024);
+
+	// Find the entry of a pair, or add a new one which is not valid.
+	// @return	Index of the entry, valid until the next EndFrame.
+	uint32_t Get(uint16_t id1, uint16_t id2);
+
+	// Warm start of an entry. The reference is valid until the next Get
+	// or EndFrame, which may move the entries.
+	GjkWarmStart& warm(uint32_t entry) { return entries_[entry].warm; }
+
+	// Remove the entries not used in the last max_age frames, then start
+	// a new frame.
+	void EndFrame(uint32_t max_age = 2);
+
+	void Clear();
+
+	std::size_t size() const { return entries_.size(); }
+
+private:
+	static const uint32_t kEmptyKey = 0xffffffff;
+
+	struct Slot
+	{
+		uint32_t key;
+
+		// Index of the entry in entries_.
+		uint32_t entry;
+	};
+
+	struct Entry
+	{
+		GjkWarmStart warm;
+		uint32_t key;
+
+		// The last frame the pair was checked.
+		uint32_t frame;
+
+		// Index of the slot in slots_.
+		uint32_t slot;
+	};
+
+	static uint32_t Key(uint16_t id1, uint16_t id2)
+	{
+		if (id1 > id2)
+			std::swap(id1, id2);
+		return (static_cast<uint32_t>(id1) << 16) | id2;
+	}
+
+	uint32_t Home(uint32_t key) const
+	{
+		// Fibonacci hashing.
+		return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask_;
+	}
+
+	// Remove an entry, shift the slots after it back and move the last
+	// entry into its place.
+	void Erase(uint32_t entry);
+
+	// Double the table.
+	void Grow();
+
+	std::vector<Slot> slots_;
+	uint32_t mask_ = 0;
+
+	std::vector<Entry> entries_;
+
+	uint32_t frame_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+#include "raycast.h"
+
+#include <cmath>
+
+using namespace ysd_phy_2d;
+
+bool ysd_phy_2d::Raycast(const CircleCollider& collider, const Ray& ray, RaycastHit* hit)
+{
+	return RaycastCircle(collider.id(), collider.Center(), collider.Radius(), ray, hit);
+}
+
+bool ysd_phy_2d::RaycastCircle(uint16_t id, const Vector2& center, float radius, const Ray& ray, RaycastHit* hit)
+{
+	// Solve |origin + direction * t - center| = radius for the smaller t.
+	// It is solved from the point of the ray closest to the center, which
+	// keeps the precision far from the origin.
+	Vector2 m = center - ray.origin;
+	if (Vector2::Dot(m, m) < radius * radius)
+		return false;
+
+	float rr = Vector2::Dot(ray.direction, ray.direction);
+	if (rr < Vector2::kEpsinon)
+		return false;
+
+	float closest = Vector2::Dot(m, ray.direction) / rr;
+	Vector2 offset = m - ray.direction * closest;
+	float h = radius * radius - Vector2::Dot(offset, offset);
+	if (h < 0)
+		return false;
+
+	float fraction = closest - std::sqrt(h / rr);
+	if (fraction < 0 || fraction > ray.max_fraction)
+		return false;
+
+	hit->id = id;
+	hit->fraction = fraction;
+	hit->point = ray.origin + ray.direction * fraction;
+	hit->normal = (hit->point - center) / radius;
+	return true;
+}
+
+bool ysd_phy_2d::Raycast(const PolygonCollider& collider, const Ray& ray, RaycastHit* hit)
+{
+	const std::vector<Vector2>& normals = collider.world_normals();
+	return RaycastPolygon(collider.id(), collider.world_xs(), collider.world_ys(), normals.data(), normals.size(), ray, hit);
+}
+
+bool ysd_phy_2d::RaycastPolygon(uint16_t id, const float* xs, const float* ys, const Vector2* normals, std::size_t count,
+								const Ray& ray, RaycastHit* hit)
+{
+	// Clip the ray by the half planes of the edges.
+	float lower = 0, upper = ray.max_fraction;
+	std::size_t edge = count;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const Vector2& normal = normals[i];
+
+		// The ray is inside the half plane from lower / upper on.
+		float numerator = normal.x() * (xs[i] - ray.origin.x()) + normal.y() * (ys[i] - ray.origin.y());
+		float denominator = Vector2::Dot(normal, ray.direction);
+
+		if (denominator == 0)
+		{
+			// Parallel to the edge and outside of it.
+			if (numerator < 0)
+				return false;
+		}
+		else if (denominator < 0 && numerator < lower * denominator)
+		{
+			// Entering the half plane.
+			lower = numerator / denominator;
+			edge = i;
+		}
+		else if (denominator > 0 && numerator < upper * denominator)
+		{
+			// Leaving the half plane.
+			upper = numerator / denominator;
+		}
+
+		if (upper < lower)
+			return false;
+	}
+
+	// No edge entered, the origin is inside.
+	if (edge == count)
+		return false;
+
+	hit->id = id;
+	hit->fraction = lower;
+	hit->point = ray.origin + ray.direction * lower;
+	hit->normal = normals[edge];
+	return true;
+}
+
+bool ysd_phy_2d::Raycast(const BaseCollider& collider, const Ray& ray, RaycastHit* hit)
+{
+	if (collider.type() == kCircleColliderType)
+		return Raycast(static_cast<const CircleCollider&>(collider), ray, hit);
+	return Raycast(static_cast<const PolygonCollider&>(collider), ray, hit);
+}
@@ -0,0 +1,112 @@
+//////////////////////////////////////////////////////
+// @fileoverview Ray casts against the colliders.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#ifndef _RAYCAST_H_
+#define _RAYCAST_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#include "../math/vector_2.h"
+#include "../math/bound.h"
+#include "collider.h"
+
+namespace ysd_phy_2d
+{
+
+// A ray from origin to origin + direction * max_fraction.
+// For a segment cast from a to b, the direction is b - a and max_fraction
+// is 1. For a ray of a range, the direction is a unit vector and
+// max_fraction is the range.
+struct Ray
+{
+	Vector2 origin;
+	Vector2 direction;
+	float max_fraction;
+};
+
+// Where a ray enters a collider.
+struct RaycastHit
+{
+	uint16_t id;
+
+	// The hit point is origin + direction * fraction.
+	float fraction;
+	Vector2 point;
+
+	// Unit normal of the collider's surface at the point.
+	Vector2 normal;
+};
+
+// Cast a ray against the colliders in world space. A ray starting inside
+// a collider does not hit it.
+// @param[out]	hit		Written only if the ray hits the collider within
+//						its max fraction.
+bool Raycast(const CircleCollider& collider, const Ray& ray, RaycastHit* hit);
+
+// Caches the world data of the polygon if it moved, see
+// PolygonCollider::UpdateCaches.
+bool Raycast(const PolygonCollider& collider, const Ray& ray, RaycastHit* hit);
+
+bool Raycast(const BaseCollider& collider, const Ray& ray, RaycastHit* hit);
+
+// The same casts on the shapes in world space, for copies of the
+// colliders such as WorldSnapshot.
+bool RaycastCircle(uint16_t id, const Vector2& center, float radius, const Ray& ray, RaycastHit* hit);
+
+// @param[in]	normals		Unit outward normal of the edge from the ith
+//							vertex to the next one.
+bool RaycastPolygon(uint16_t id, const float* xs, const float* ys, const Vector2* normals, std::size_t count,
+					const Ray& ray, RaycastHit* hit);
+
+// Find where a ray enters a bound, the slab test.
+// @param[in]	inv_direction	1 / direction of the ray, per axis.
+// @param[in]	max_fraction	The bound is missed if it is entered after it.
+// @param[out]	fraction		Zero if the origin is inside the bound.
+inline bool RaycastBound(const Bound& bound, const Ray& ray, const Vector2& inv_direction, float max_fraction, float* fraction)
+{
+	float lower = 0, upper = max_fraction;
+
+	if (ray.direction.x() == 0)
+	{
+		if (ray.origin.x() < bound.min.x() || ray.origin.x() > bound.max.x())
+			return false;
+	}
+	else
+	{
+		float t1 = (bound.min.x() - ray.origin.x()) * inv_direction.x();
+		float t2 = (bound.max.x() - ray.origin.x()) * inv_direction.x();
+		lower = std::max(lower, std::min(t1, t2));
+		upper = std::min(upper, std::max(t1, t2));
+	}
+
+	if (ray.direction.y() == 0)
+	{
+		if (ray.origin.y() < bound.min.y() || ray.origin.y() > bound.max.y())
+			return false;
+	}
+	else
+	{
+		float t1 = (bound.min.y() - ray.origin.y()) * inv_direction.y();
+		float t2 = (bound.max.y() - ray.origin.y()) * inv_direction.y();
+		lower = std::max(lower, std::min(t1, t2));
+		upper = std::min(upper, std::max(t1, t2));
+	}
+
+	*fraction = lower;
+	return lower <= upper;
+}
+
+// 1 / direction per axis, zero for an axis the ray does not move along.
+inline Vector2 InverseDirection(const Ray& ray)
+{
+	return Vector2(ray.direction.x() != 0 ? 1 / ray.direction.x() : 0,
+				   ray.direction.y() != 0 ? 1 / ray.direction.y() : 0);
+}
+
+}
+
+#endif
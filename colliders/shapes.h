@@ -107,7 +107,7 @@ public:
 		if (!changed_)
 			return center_;
 
-		float x, y;
+		float x = 0, y = 0;
 		for (std::size_t i = 0, l = vertices_.size(); i < l; i++)
 		{
 			x += vertices_[i].x();
@@ -116,6 +116,7 @@ public:
 		x /= vertices_.size();
 		y /= vertices_.size();
 		center_ = Vector2(x, y);
+		changed_ = false;
 		return center_;
 	}
 
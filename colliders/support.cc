@@ -0,0 +1,150 @@
+#include "support.h"
+
+#include <limits>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace ysd_phy_2d;
+
+std::size_t ysd_phy_2d::IndexOfFurthestPoint(const float* xs, const float* ys,
+											 std::size_t size, const Vector2& dir)
+{
+	const float dx = dir.x();
+	const float dy = dir.y();
+
+	std::size_t fi = 0;
+	float fdot = -std::numeric_limits<float>::infinity();
+	std::size_t i = 0;
+
+	// Every lane keeps its own furthest point, then the lanes are reduced.
+	// A lane only takes a strictly further point, and the reduction takes
+	// the lowest index on a tie, so the first furthest point wins as in
+	// the scalar scan.
+#if defined(__AVX2__)
+	if (size >= 8)
+	{
+		const __m256 vdx = _mm256_set1_ps(dx);
+		const __m256 vdy = _mm256_set1_ps(dy);
+		__m256 vbest = _mm256_set1_ps(fdot);
+		__m256i vbest_index = _mm256_setzero_si256();
+		__m256i vindex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		const __m256i vstep = _mm256_set1_epi32(8);
+
+		for (; i + 8 <= size; i += 8)
+		{
+			__m256 dot = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(xs + i), vdx),
+									   _mm256_mul_ps(_mm256_loadu_ps(ys + i), vdy));
+			__m256 further = _mm256_cmp_ps(dot, vbest, _CMP_GT_OQ);
+			vbest = _mm256_blendv_ps(vbest, dot, further);
+			vbest_index = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(vbest_index),
+															   _mm256_castsi256_ps(vindex), further));
+			vindex = _mm256_add_epi32(vindex, vstep);
+		}
+
+		alignas(32) float best[8];
+		alignas(32) int32_t best_index[8];
+		_mm256_store_ps(best, vbest);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(best_index), vbest_index);
+		for (std::size_t l = 0; l < 8; ++l)
+		{
+			std::size_t index = static_cast<std::size_t>(best_index[l]);
+			if (best[l] > fdot || (best[l] == fdot && index < fi))
+			{
+				fdot = best[l];
+				fi = index;
+			}
+		}
+	}
+#elif defined(__SSE2__)
+	if (size >= 4)
+	{
+		const __m128 vdx = _mm_set1_ps(dx);
+		const __m128 vdy = _mm_set1_ps(dy);
+		__m128 vbest = _mm_set1_ps(fdot);
+		__m128i vbest_index = _mm_setzero_si128();
+		__m128i vindex = _mm_setr_epi32(0, 1, 2, 3);
+		const __m128i vstep = _mm_set1_epi32(4);
+
+		for (; i + 4 <= size; i += 4)
+		{
+			__m128 dot = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(xs + i), vdx),
+									_mm_mul_ps(_mm_loadu_ps(ys + i), vdy));
+			__m128 further = _mm_cmpgt_ps(dot, vbest);
+			__m128i mask = _mm_castps_si128(further);
+			vbest = _mm_or_ps(_mm_and_ps(further, dot), _mm_andnot_ps(further, vbest));
+			vbest_index = _mm_or_si128(_mm_and_si128(mask, vindex), _mm_andnot_si128(mask, vbest_index));
+			vindex = _mm_add_epi32(vindex, vstep);
+		}
+
+		alignas(16) float best[4];
+		alignas(16) int32_t best_index[4];
+		_mm_store_ps(best, vbest);
+		_mm_store_si128(reinterpret_cast<__m128i*>(best_index), vbest_index);
+		for (std::size_t l = 0; l < 4; ++l)
+		{
+			std::size_t index = static_cast<std::size_t>(best_index[l]);
+			if (best[l] > fdot || (best[l] == fdot && index < fi))
+			{
+				fdot = best[l];
+				fi = index;
+			}
+		}
+	}
+#endif
+
+	// The rest, or all vertices without SIMD.
+	for (; i < size; ++i)
+	{
+		float dot = xs[i] * dx + ys[i] * dy;
+		if (dot > fdot)
+		{
+			fdot = dot;
+			fi = i;
+		}
+	}
+	return fi;
+}
+
+std::size_t ysd_phy_2d::HillClimbFurthestPoint(const float* xs, const float* ys,
+											   std::size_t size, const Vector2& dir,
+											   std::size_t start)
+{
+	const float dx = dir.x();
+	const float dy = dir.y();
+
+	std::size_t fi = start < size ? start : 0;
+	float fdot = xs[fi] * dx + ys[fi] * dy;
+
+	// Walk forward while the next vertex is not nearer. A run of equal
+	// vertices is crossed, it is an edge perpendicular to the direction,
+	// and the nearest side of the polygon can be one.
+	bool moved = false;
+	for (std::size_t n = 0; n < size; ++n)
+	{
+		std::size_t next = fi + 1 == size ? 0 : fi + 1;
+		float dot = xs[next] * dx + ys[next] * dy;
+		if (dot < fdot)
+			break;
+		fdot = dot;
+		fi = next;
+		moved = true;
+	}
+
+	// A nearer vertex after a further or an equal one, that is the peak.
+	if (moved)
+		return fi;
+
+	// Otherwise the peak, if not here, is backward.
+	for (std::size_t n = 0; n < size; ++n)
+	{
+		std::size_t prev = fi == 0 ? size - 1 : fi - 1;
+		float dot = xs[prev] * dx + ys[prev] * dy;
+		if (dot < fdot)
+			break;
+		fdot = dot;
+		fi = prev;
+	}
+	return fi;
+}
@@ -0,0 +1,71 @@
+//////////////////////////////////////////////////////
+// @fileoverview Support mapping of convex polygons
+//				 for GJK.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#ifndef _SUPPORT_H_
+#define _SUPPORT_H_
+
+#include <cstddef>
+
+#include "../math/vector_2.h"
+
+namespace ysd_phy_2d
+{
+
+// A polygon with more vertices is searched by hill climbing instead of
+// a scan over all vertices.
+const std::size_t kHillClimbVertices = 16;
+
+// Vertices of a convex polygon in world space, structure of arrays. The
+// vertices are in order along the boundary.
+struct SupportVertices
+{
+	const float* xs;
+	const float* ys;
+	std::size_t size;
+
+	// Index of the last support point. A new search starts from it.
+	std::size_t last;
+};
+
+// Get the furthest point along the certain direction by checking all
+// vertices, 8 or 4 at a time with AVX2 or SSE2.
+// @return	The first index of the furthest points.
+std::size_t IndexOfFurthestPoint(const float* xs, const float* ys,
+								 std::size_t size, const Vector2& dir);
+
+// Get the furthest point along the certain direction by walking from a
+// vertex to the neighbour that is further, until none is. The dot product
+// along the boundary of a convex polygon has a single peak, so the walk
+// ends at the furthest point. Collinear vertices or an edge perpendicular
+// to the direction make flat runs, the walk crosses them. It only visits
+// a few vertices if the start is close to the answer, e.g. the last
+// support point of GJK.
+std::size_t HillClimbFurthestPoint(const float* xs, const float* ys,
+								   std::size_t size, const Vector2& dir,
+								   std::size_t start);
+
+// Get the furthest point of the vertices along the direction, and
+// remember it as the start of the next search.
+inline std::size_t FurthestPoint(SupportVertices& verts, const Vector2& dir)
+{
+	std::size_t i = verts.size > kHillClimbVertices ?
+		HillClimbFurthestPoint(verts.xs, verts.ys, verts.size, dir, verts.last) :
+		IndexOfFurthestPoint(verts.xs, verts.ys, verts.size, dir);
+	verts.last = i;
+	return i;
+}
+
+// Minkowski sum support function for GJK.
+inline Vector2 Support(SupportVertices& verts1, SupportVertices& verts2, const Vector2& dir)
+{
+	std::size_t i = FurthestPoint(verts1, dir);
+	std::size_t j = FurthestPoint(verts2, -dir);
+	return Vector2(verts1.xs[i] - verts2.xs[j], verts1.ys[i] - verts2.ys[j]);
+}
+
+}
+
+#endif
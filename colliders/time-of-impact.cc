@@ -0,0 +1,333 @@
+#include "time-of-impact.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "distance.h"
+
+using namespace ysd_phy_2d;
+
+// The colliders are swept relative to the second one, which stays at
+// its end of the step. The first one starts at its end minus the
+// relative sweep.
+
+// First time in [0, 1] a point moving from origin by direction reach a
+// circle. The origin is outside of the circle.
+static bool SweepPointToCircle(const Vector2& origin, const Vector2& direction, float rr,
+							   const Vector2& center, float radius, float* time)
+{
+	Vector2 m = center - origin;
+	float closest = Vector2::Dot(m, direction) / rr;
+	if (closest < 0)
+		return false;
+
+	Vector2 offset = m - direction * closest;
+	float h = radius * radius - Vector2::Dot(offset, offset);
+	if (h < 0)
+		return false;
+
+	float t = closest - std::sqrt(h / rr);
+	if (t > 1)
+		return false;
+
+	*time = std::max(t, 0.0f);
+	return true;
+}
+
+// Fill a collision found at a time of the step. The normal and points
+// are given in the frame of the second collider at the end of the step.
+static void FillImpact(uint16_t id1, uint16_t id2, const Vector2& sweep2, float time,
+					   const Vector2& normal, const Vector2* points, uint8_t point_count, Collision* collision)
+{
+	collision->first = id1;
+	collision->second = id2;
+	collision->normal = normal;
+	collision->depth = 0;
+	for (uint8_t i = 0; i < point_count; ++i)
+	{
+		collision->points[i] = points[i] - sweep2 * (1 - time);
+	}
+	collision->point_count = point_count;
+	collision->time_of_impact = time;
+}
+
+bool ysd_phy_2d::TimeOfImpact(const CircleCollider& collider1, const Vector2& sweep1,
+							  const CircleCollider& collider2, const Vector2& sweep2, Collision* collision)
+{
+	Vector2 sweep = sweep1 - sweep2;
+	float rr = Vector2::Dot(sweep, sweep);
+	if (rr < Vector2::kEpsinon)
+		return false;
+
+	// A point against a circle of the sum of the radius.
+	const float radius = collider1.Radius() + collider2.Radius();
+	Vector2 origin = collider1.Center() - sweep;
+	float time = 0;
+	if (Vector2::SqrDistance(origin, collider2.Center()) > radius * radius &&
+		!SweepPointToCircle(origin, sweep, rr, collider2.Center(), radius, &time))
+	{
+		return false;
+	}
+
+	Vector2 center1 = origin + sweep * time;
+	Vector2 normal = collider2.Center() - center1;
+	float length = normal.length();
+	normal = length > Vector2::kEpsinon ? normal / length : sweep / std::sqrt(rr);
+
+	Vector2 point = center1 + normal * collider1.Radius();
+	FillImpact(collider1.id(), collider2.id(), sweep2, time, normal, &point, 1, collision);
+	return true;
+}
+
+bool ysd_phy_2d::TimeOfImpact(const CircleCollider& collider1, const Vector2& sweep1,
+							  const PolygonCollider& collider2, const Vector2& sweep2, Collision* collision)
+{
+	Vector2 sweep = sweep1 - sweep2;
+	float rr = Vector2::Dot(sweep, sweep);
+	if (rr < Vector2::kEpsinon)
+		return false;
+
+	const float radius = collider1.Radius();
+	Vector2 origin = collider1.Center() - sweep;
+
+	// Overlapping at the start, they touch along the sweep.
+	if (Distance(collider2, origin) <= radius)
+	{
+		Vector2 normal = sweep / std::sqrt(rr);
+		Vector2 point = origin + normal * radius;
+		FillImpact(collider1.id(), collider2.id(), sweep2, 0, normal, &point, 1, collision);
+		return true;
+	}
+
+	// The center against the polygon grown by the radius: the edges moved
+	// out by the radius, and a circle at every corner.
+	const float* xs = collider2.world_xs();
+	const float* ys = collider2.world_ys();
+	const std::vector<Vector2>& normals = collider2.world_normals();
+	const std::size_t count = normals.size();
+
+	float best = std::numeric_limits<float>::max();
+	Vector2 normal = Vector2::kZero, point = Vector2::kZero;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const Vector2& edge_normal = normals[i];
+		float denominator = Vector2::Dot(edge_normal, sweep);
+		if (denominator >= 0)
+			continue;
+
+		Vector2 a(xs[i], ys[i]);
+		float t = (radius - Vector2::Dot(edge_normal, origin - a)) / denominator;
+		if (t < 0 || t > 1 || t >= best)
+			continue;
+
+		// The circle touches the edge itself, not the line beyond it.
+		std::size_t j = i + 1 == count ? 0 : i + 1;
+		Vector2 edge = Vector2(xs[j], ys[j]) - a;
+		Vector2 q = origin + sweep * t - edge_normal * radius;
+		float s = Vector2::Dot(q - a, edge);
+		if (s < 0 || s > Vector2::Dot(edge, edge))
+			continue;
+
+		best = t;
+		normal = -edge_normal;
+		point = q;
+	}
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		Vector2 corner(xs[i], ys[i]);
+		float t;
+		if (!SweepPointToCircle(origin, sweep, rr, corner, radius, &t) || t >= best)
+			continue;
+
+		best = t;
+		normal = (corner - (origin + sweep * t)) / radius;
+		point = corner;
+	}
+
+	if (best > 1)
+		return false;
+
+	FillImpact(collider1.id(), collider2.id(), sweep2, best, normal, &point, 1, collision);
+	return true;
+}
+
+// A vertex this close to the extreme of a polygon along the normal is on
+// the touching feature, two of them make a face parallel to the contact.
+static const float kFeatureTolerance = 1e-3f;
+
+// Span along the tangent of the vertices of a polygon at most
+// kFeatureTolerance below its extreme along a direction. The vertices are
+// moved by offset.
+static void FeatureSpan(const float* xs, const float* ys, std::size_t count, const Vector2& offset,
+						const Vector2& dir, const Vector2& tangent, float* lower, float* upper)
+{
+	float extreme = -std::numeric_limits<float>::max();
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		extreme = std::max(extreme, dir.x() * (xs[i] + offset.x()) + dir.y() * (ys[i] + offset.y()));
+	}
+
+	*lower = std::numeric_limits<float>::max();
+	*upper = -std::numeric_limits<float>::max();
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		Vector2 p(xs[i] + offset.x(), ys[i] + offset.y());
+		if (Vector2::Dot(dir, p) < extreme - kFeatureTolerance)
+			continue;
+
+		float t = Vector2::Dot(tangent, p);
+		*lower = std::min(*lower, t);
+		*upper = std::max(*upper, t);
+	}
+}
+
+// Projection of a polygon on an axis.
+static void Project(const float* xs, const float* ys, std::size_t count, const Vector2& axis,
+					float* min, float* max, std::size_t* min_index, std::size_t* max_index)
+{
+	*min = std::numeric_limits<float>::max();
+	*max = -std::numeric_limits<float>::max();
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		float d = axis.x() * xs[i] + axis.y() * ys[i];
+		if (d < *min)
+		{
+			*min = d;
+			*min_index = i;
+		}
+		if (d > *max)
+		{
+			*max = d;
+			*max_index = i;
+		}
+	}
+}
+
+bool ysd_phy_2d::TimeOfImpact(const PolygonCollider& collider1, const Vector2& sweep1,
+							  const PolygonCollider& collider2, const Vector2& sweep2, Collision* collision)
+{
+	Vector2 sweep = sweep1 - sweep2;
+	if (Vector2::Dot(sweep, sweep) < Vector2::kEpsinon)
+		return false;
+
+	const float* xs1 = collider1.world_xs();
+	const float* ys1 = collider1.world_ys();
+	const float* xs2 = collider2.world_xs();
+	const float* ys2 = collider2.world_ys();
+	const std::size_t count1 = collider1.vertex_count();
+	const std::size_t count2 = collider2.vertex_count();
+
+	// Separating axes swept over the step. On an axis the first polygon
+	// moves by v * (t - 1), it overlaps the second one in a time interval.
+	// They touch when the intervals of all axes overlap, the latest entry
+	// is the time of impact.
+	float entry = -std::numeric_limits<float>::max();
+	float exit = std::numeric_limits<float>::max();
+	Vector2 normal;
+	std::size_t support = 0;
+	bool axis_of_first = false;
+	for (int k = 0; k < 2; ++k)
+	{
+		const std::vector<Vector2>& axes = k == 0 ? collider1.world_normals() : collider2.world_normals();
+		for (const Vector2& axis : axes)
+		{
+			float min1, max1, min2, max2;
+			std::size_t min_index1 = 0, max_index1 = 0, min_index2 = 0, max_index2 = 0;
+			Project(xs1, ys1, count1, axis, &min1, &max1, &min_index1, &max_index1);
+			Project(xs2, ys2, count2, axis, &min2, &max2, &min_index2, &max_index2);
+
+			float v = Vector2::Dot(axis, sweep);
+			if (std::fabs(v) < Vector2::kEpsinon)
+			{
+				// Not moving along the axis, separated for the whole step.
+				if (max1 < min2 || max2 < min1)
+					return false;
+				continue;
+			}
+
+			float enter = 1 + (v > 0 ? min2 - max1 : max2 - min1) / v;
+			float leave = 1 + (v > 0 ? max2 - min1 : min2 - max1) / v;
+			if (enter > entry)
+			{
+				entry = enter;
+				normal = v > 0 ? axis : -axis;
+				axis_of_first = k == 0;
+
+				// The corner of the other polygon hits the face.
+				support = k == 0 ? (v > 0 ? min_index2 : max_index2) : (v > 0 ? max_index1 : min_index1);
+			}
+			exit = std::min(exit, leave);
+
+			if (entry > exit || entry > 1 || exit < 0)
+				return false;
+		}
+	}
+
+	// Only parallel to the sweep on every axis, left to the discrete check.
+	if (entry == -std::numeric_limits<float>::max())
+		return false;
+
+	float time = std::max(entry, 0.0f);
+	Vector2 offset1 = -sweep * (1 - time);
+
+	// When the touching features are both faces, the contact is where
+	// they overlap: the incident face clipped by the side planes of the
+	// reference face, like ClipContacts of DoCheck, along the tangent.
+	Vector2 tangent(-normal.y(), normal.x());
+	float lower1, upper1, lower2, upper2;
+	FeatureSpan(xs1, ys1, count1, offset1, normal, tangent, &lower1, &upper1);
+	FeatureSpan(xs2, ys2, count2, Vector2::kZero, -normal, tangent, &lower2, &upper2);
+	float lower = std::max(lower1, lower2);
+	float upper = std::min(upper1, upper2);
+	if (upper - lower > kFeatureTolerance)
+	{
+		// On the face of the second polygon.
+		float face = std::numeric_limits<float>::max();
+		for (std::size_t i = 0; i < count2; ++i)
+		{
+			face = std::min(face, normal.x() * xs2[i] + normal.y() * ys2[i]);
+		}
+		Vector2 points[2] = { normal * face + tangent * lower, normal * face + tangent * upper };
+		FillImpact(collider1.id(), collider2.id(), sweep2, time, normal, points, 2, collision);
+		return true;
+	}
+
+	// A corner touches a face.
+	Vector2 point = axis_of_first ? Vector2(xs2[support], ys2[support]) :
+		Vector2(xs1[support], ys1[support]) + offset1;
+	FillImpact(collider1.id(), collider2.id(), sweep2, time, normal, &point, 1, collision);
+	return true;
+}
+
+bool ysd_phy_2d::TimeOfImpact(const BaseCollider& collider1, const Vector2& sweep1,
+							  const BaseCollider& collider2, const Vector2& sweep2, Collision* collision)
+{
+	bool circle1 = collider1.type() == kCircleColliderType;
+	bool circle2 = collider2.type() == kCircleColliderType;
+	if (circle1 && circle2)
+	{
+		return TimeOfImpact(static_cast<const CircleCollider&>(collider1), sweep1,
+							static_cast<const CircleCollider&>(collider2), sweep2, collision);
+	}
+
+	if (circle1)
+	{
+		return TimeOfImpact(static_cast<const CircleCollider&>(collider1), sweep1,
+							static_cast<const PolygonCollider&>(collider2), sweep2, collision);
+	}
+
+	if (circle2)
+	{
+		// The circle is swept first, then the collision is turned around.
+		bool hit = TimeOfImpact(static_cast<const CircleCollider&>(collider2), sweep2,
+								static_cast<const PolygonCollider&>(collider1), sweep1, collision);
+		if (hit)
+			collision->Flip();
+		return hit;
+	}
+
+	return TimeOfImpact(static_cast<const PolygonCollider&>(collider1), sweep1,
+						static_cast<const PolygonCollider&>(collider2), sweep2, collision);
+}
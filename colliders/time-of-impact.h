@@ -0,0 +1,43 @@
+//////////////////////////////////////////////////////
+// @fileoverview Time of impact of two colliders
+//				 moving in a step.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#ifndef _TIME_OF_IMPACT_H_
+#define _TIME_OF_IMPACT_H_
+
+#include "../math/vector_2.h"
+#include "collider.h"
+#include "collision.h"
+
+namespace ysd_phy_2d
+{
+
+// Find the first time two colliders touch while they move in a step.
+//
+// The colliders are at their positions at the end of the step, and
+// moved by sweep1 and sweep2 in the step. The translation is linear,
+// the rotation is taken at the end of the step for the whole step.
+//
+// If they touch, the collision gets the time as a fraction of the step,
+// the normal from the first collider to the second one, and the contact
+// points where they touch at that time: two ends of the overlap when two
+// polygons touch by parallel faces, one point otherwise. The depth is
+// zero. Colliders already overlapping at the start touch at 0.
+bool TimeOfImpact(const CircleCollider& collider1, const Vector2& sweep1,
+				  const CircleCollider& collider2, const Vector2& sweep2, Collision* collision);
+
+bool TimeOfImpact(const CircleCollider& collider1, const Vector2& sweep1,
+				  const PolygonCollider& collider2, const Vector2& sweep2, Collision* collision);
+
+// The world data of polygons must be cached, see PolygonCollider::UpdateCaches.
+bool TimeOfImpact(const PolygonCollider& collider1, const Vector2& sweep1,
+				  const PolygonCollider& collider2, const Vector2& sweep2, Collision* collision);
+
+bool TimeOfImpact(const BaseCollider& collider1, const Vector2& sweep1,
+				  const BaseCollider& collider2, const Vector2& sweep2, Collision* collision);
+
+}
+
+#endif
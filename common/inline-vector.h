@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////
+// @fileoverview Template class defination of a vector
+//				 with inline storage.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#ifndef _INLINE_VECTOR_H_
+#define _INLINE_VECTOR_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <assert.h>
+
+#include "un-copy-move-interface.h"
+
+namespace ysd_phy_2d
+{
+
+////////////////////////////////////////////////////////////
+// A vector that keeps the first N elements inside itself
+// and only goes to the heap when it has more.
+//
+// Only for trivially copyable types. It can not be copied
+// or moved since it may point to its own storage.
+////////////////////////////////////////////////////////////
+template <typename T, std::size_t N>
+class InlineVector : public IUnCopyMovable
+{
+	static_assert(std::is_trivially_copyable<T>::value, "InlineVector only holds trivially copyable types.");
+
+public:
+	InlineVector() = default;
+
+	~InlineVector()
+	{
+		if (data_ != inline_)
+			delete[] data_;
+	}
+
+	void push_back(const T& value)
+	{
+		if (size_ == capacity_)
+		{
+			Grow();
+		}
+		data_[size_++] = value;
+	}
+
+	void pop_back()
+	{
+		assert(size_ > 0);
+		--size_;
+	}
+
+	void clear() { size_ = 0; }
+
+	T& back() { return data_[size_ - 1]; }
+	const T& back() const { return data_[size_ - 1]; }
+
+	T& operator[](std::size_t i) { return data_[i]; }
+	const T& operator[](std::size_t i) const { return data_[i]; }
+
+	T* begin() { return data_; }
+	T* end() { return data_ + size_; }
+	const T* begin() const { return data_; }
+	const T* end() const { return data_ + size_; }
+
+	T* data() { return data_; }
+	const T* data() const { return data_; }
+
+	std::size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+
+	// True if the elements are on the heap.
+	bool spilled() const { return data_ != inline_; }
+
+private:
+	void Grow()
+	{
+		uint32_t capacity = capacity_ * 2;
+		T* data = new T[capacity];
+		std::memcpy(data, data_, size_ * sizeof(T));
+		if (data_ != inline_)
+			delete[] data_;
+		data_ = data;
+		capacity_ = capacity;
+	}
+
+	T* data_ = inline_;
+	uint32_t size_ = 0;
+	uint32_t capacity_ = N;
+	T inline_[N];
+};
+
+}
+
+#endif
@@ -0,0 +1,114 @@
+//////////////////////////////////////////////////////
+// @fileoverview Template class defination of a free
+//				 list object pool.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#ifndef _OBJECT_POOL_H_
+#define _OBJECT_POOL_H_
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include "un-copy-move-interface.h"
+
+namespace ysd_phy_2d
+{
+
+////////////////////////////////////////////////////////////
+// An ObjectPool allocate objects of the same type from big
+// chunks and keep the freed ones in a free list.
+//
+// The memory is never given back before the pool is
+// destroyed, but it is reused, so the memory is bounded by
+// the peak number of objects. The last freed object is the
+// first to be reused, which is still warm in the cache.
+//
+// The alignment of T is respected, e.g. a type declared
+// with alignas(64) starts at a cache line.
+//
+// The pool does not destroy the objects that are not freed.
+////////////////////////////////////////////////////////////
+template <typename T, std::size_t kChunkSize = 256>
+class ObjectPool : public IUncopyable
+{
+public:
+	ObjectPool() = default;
+
+	ObjectPool(ObjectPool&& other)
+		: chunks_(std::move(other.chunks_)), free_(other.free_), size_(other.size_)
+	{
+		other.free_ = nullptr;
+		other.size_ = 0;
+	}
+
+	template <typename... Args>
+	T* Allocate(Args&&... args)
+	{
+		if (free_ == nullptr)
+		{
+			AddChunk();
+		}
+
+		FreeSlot* slot = free_;
+		free_ = slot->next;
+		++size_;
+		return new (slot) T(std::forward<Args>(args)...);
+	}
+
+	void Free(T* obj)
+	{
+		obj->~T();
+		FreeSlot* slot = reinterpret_cast<FreeSlot*>(obj);
+		slot->next = free_;
+		free_ = slot;
+		--size_;
+	}
+
+	// Number of the objects in use.
+	std::size_t size() const { return size_; }
+
+	// Number of the objects the pool can hold without allocation.
+	std::size_t capacity() const { return chunks_.size() * kChunkSize; }
+
+private:
+	struct FreeSlot
+	{
+		FreeSlot* next;
+	};
+
+	static const std::size_t kSlotAlign = alignof(T) > alignof(FreeSlot) ? alignof(T) : alignof(FreeSlot);
+	static const std::size_t kSlotSize = ((sizeof(T) > sizeof(FreeSlot) ? sizeof(T) : sizeof(FreeSlot)) + kSlotAlign - 1) / kSlotAlign * kSlotAlign;
+
+	void AddChunk()
+	{
+		std::unique_ptr<unsigned char[]> chunk(new unsigned char[kSlotSize * kChunkSize + kSlotAlign]);
+
+		// Align the first slot.
+		std::uintptr_t address = reinterpret_cast<std::uintptr_t>(chunk.get());
+		address = (address + kSlotAlign - 1) / kSlotAlign * kSlotAlign;
+		unsigned char* begin = reinterpret_cast<unsigned char*>(address);
+
+		// Link the slots in order, the first one is used first.
+		for (std::size_t i = kChunkSize; i > 0; --i)
+		{
+			FreeSlot* slot = reinterpret_cast<FreeSlot*>(begin + (i - 1) * kSlotSize);
+			slot->next = free_;
+			free_ = slot;
+		}
+
+		chunks_.push_back(std::move(chunk));
+	}
+
+	std::vector<std::unique_ptr<unsigned char[]>> chunks_;
+	FreeSlot* free_ = nullptr;
+	std::size_t size_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,49 @@
+//////////////////////////////////////////////////////
+// @fileoverview Template class defination of a view
+//				 of contiguous elements.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#ifndef _SPAN_H_
+#define _SPAN_H_
+
+#include <cstddef>
+
+namespace ysd_phy_2d
+{
+
+////////////////////////////////////////////////////////////
+// A Span refer to a range of contiguous elements owned by
+// someone else. It is cheap to copy and never allocates.
+////////////////////////////////////////////////////////////
+template <typename T>
+class Span
+{
+public:
+	Span() = default;
+
+	Span(T* data, std::size_t size)
+		: data_(data), size_(size)
+	{}
+
+	Span(T* begin, T* end)
+		: data_(begin), size_(static_cast<std::size_t>(end - begin))
+	{}
+
+	T& operator[](std::size_t i) const { return data_[i]; }
+
+	T* begin() const { return data_; }
+	T* end() const { return data_ + size_; }
+
+	T* data() const { return data_; }
+	std::size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+
+private:
+	T* data_ = nullptr;
+	std::size_t size_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,149 @@
+#include "thread-pool.h"
+
+#include <assert.h>
+
+using namespace ysd_phy_2d;
+
+ThreadPool::ThreadPool(uint32_t thread_count)
+	: thread_count_(thread_count > 0 ? thread_count : 1), ranges_(new Range[thread_count_])
+{
+	for (uint32_t i = 0; i < thread_count_; ++i)
+	{
+		ranges_[i].tasks.store(0, std::memory_order_relaxed);
+	}
+
+	for (uint32_t i = 1; i < thread_count_; ++i)
+	{
+		threads_.emplace_back(&ThreadPool::WorkerMain, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	start_.notify_all();
+
+	for (std::thread& thread : threads_)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::Run(uint32_t task_count, TaskFunction function, void* context)
+{
+	if (task_count == 0)
+		return;
+
+	if (thread_count_ == 1 || task_count == 1)
+	{
+		for (uint32_t i = 0; i < task_count; ++i)
+			function(context, i, 0);
+		return;
+	}
+
+	// Deal the tasks out in contiguous ranges, neighbour tasks tend to
+	// touch neighbour data.
+	for (uint32_t i = 0; i < thread_count_; ++i)
+	{
+		uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(task_count) * i / thread_count_);
+		uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(task_count) * (i + 1) / thread_count_);
+		ranges_[i].tasks.store(Pack(begin, end), std::memory_order_relaxed);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		function_ = function;
+		context_ = context;
+		running_ = thread_count_ - 1;
+		++generation_;
+	}
+	start_.notify_all();
+
+	RunTasks(0);
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_.wait(lock, [this] { return running_ == 0; });
+}
+
+void ThreadPool::WorkerMain(uint32_t thread)
+{
+	uint64_t generation = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			start_.wait(lock, [this, generation] { return stop_ || generation_ != generation; });
+			if (stop_)
+				return;
+			generation = generation_;
+		}
+
+		RunTasks(thread);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (--running_ == 0)
+		{
+			done_.notify_one();
+		}
+	}
+}
+
+void ThreadPool::RunTasks(uint32_t thread)
+{
+	do
+	{
+		uint32_t task;
+		while (PopTask(thread, task))
+		{
+			function_(context_, task, thread);
+		}
+	} while (StealTasks(thread));
+}
+
+bool ThreadPool::PopTask(uint32_t thread, uint32_t& task)
+{
+	std::atomic<uint64_t>& tasks = ranges_[thread].tasks;
+	uint64_t range = tasks.load(std::memory_order_acquire);
+	for (;;)
+	{
+		uint32_t begin = static_cast<uint32_t>(range >> 32);
+		uint32_t end = static_cast<uint32_t>(range);
+		if (begin >= end)
+			return false;
+
+		if (tasks.compare_exchange_weak(range, Pack(begin + 1, end), std::memory_order_acq_rel))
+		{
+			task = begin;
+			return true;
+		}
+	}
+}
+
+bool ThreadPool::StealTasks(uint32_t thread)
+{
+	for (uint32_t i = 1; i < thread_count_; ++i)
+	{
+		std::atomic<uint64_t>& victim = ranges_[(thread + i) % thread_count_].tasks;
+		uint64_t range = victim.load(std::memory_order_acquire);
+		for (;;)
+		{
+			uint32_t begin = static_cast<uint32_t>(range >> 32);
+			uint32_t end = static_cast<uint32_t>(range);
+			if (begin >= end)
+				break;
+
+			// Take the back half, the owner keeps the front one.
+			uint32_t middle = end - (end - begin + 1) / 2;
+			if (victim.compare_exchange_weak(range, Pack(begin, middle), std::memory_order_acq_rel))
+			{
+				// The own range is empty, nobody else changes it.
+				ranges_[thread].tasks.store(Pack(middle, end), std::memory_order_release);
+				return true;
+			}
+		}
+	}
+	return false;
+}
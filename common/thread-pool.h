@@ -0,0 +1,117 @@
+//////////////////////////////////////////////////////
+// @fileoverview Class defination of a persistent
+//				 work stealing thread pool.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+#include "un-copy-move-interface.h"
+
+namespace ysd_phy_2d
+{
+
+////////////////////////////////////////////////////////////
+// A ThreadPool run the tasks of a parallel for on threads
+// that live as long as the pool.
+//
+// The tasks are numbered. Every thread gets a contiguous
+// range of them and takes its tasks from the front. A
+// thread that runs out steals the back half of another
+// thread's range, so a slow range does not keep the others
+// waiting.
+//
+// The calling thread is thread 0 and runs tasks too, a pool
+// of one thread runs everything on the calling thread.
+////////////////////////////////////////////////////////////
+class ThreadPool final : public IUnCopyMovable
+{
+public:
+	// @param[in]	thread_count	Threads that run the tasks, including
+	//								the calling thread.
+	explicit ThreadPool(uint32_t thread_count);
+
+	~ThreadPool();
+
+	// Call fn(task, thread) for every task in [0, task_count) and return
+	// when all of them are done. thread is in [0, thread_count) and no two
+	// tasks run on the same thread at the same time.
+	template <typename Fn>
+	void ParallelFor(uint32_t task_count, Fn& fn)
+	{
+		Run(task_count, &Invoke<Fn>, &fn);
+	}
+
+	uint32_t thread_count() const { return thread_count_; }
+
+private:
+	typedef void (*TaskFunction)(void* context, uint32_t task, uint32_t thread);
+
+	template <typename Fn>
+	static void Invoke(void* context, uint32_t task, uint32_t thread)
+	{
+		(*static_cast<Fn*>(context))(task, thread);
+	}
+
+	// Tasks [begin, end) of a thread, packed in 64 bits so that the owner
+	// and the thieves can take tasks with one compare and swap.
+	struct Range
+	{
+		std::atomic<uint64_t> tasks;
+
+		// Keep the ranges in different cache lines.
+		char padding[64 - sizeof(std::atomic<uint64_t>)];
+	};
+
+	static uint64_t Pack(uint32_t begin, uint32_t end)
+	{
+		return (static_cast<uint64_t>(begin) << 32) | end;
+	}
+
+	void Run(uint32_t task_count, TaskFunction function, void* context);
+
+	void WorkerMain(uint32_t thread);
+
+	// Run the thread's own tasks, then the stolen ones, until there is
+	// nothing left to steal.
+	void RunTasks(uint32_t thread);
+
+	// Take the first task of the thread's range.
+	bool PopTask(uint32_t thread, uint32_t& task);
+
+	// Move the back half of another thread's range to the thread.
+	bool StealTasks(uint32_t thread);
+
+	uint32_t thread_count_;
+	std::unique_ptr<Range[]> ranges_;
+	std::vector<std::thread> threads_;
+
+	// The parallel for being run.
+	TaskFunction function_ = nullptr;
+	void* context_ = nullptr;
+
+	std::mutex mutex_;
+	std::condition_variable start_;
+	std::condition_variable done_;
+
+	// Increased by every parallel for, a worker starts when it changes.
+	uint64_t generation_ = 0;
+
+	// Workers that have not finished the current parallel for.
+	uint32_t running_ = 0;
+
+	bool stop_ = false;
+};
+
+}
+
+#endif
@@ -33,17 +33,46 @@ inline bool BoundinBound(const Bound& big, const Bound& small)
 // @return Return true if two bounds were contacted.
 inline bool BoundContactBound(const Bound& b1, const Bound& b2)
 {
-	float min_x = std::max(b1.min.x, b2.min.x);
-	float max_x = std::min(b1.max.x, b2.max.x);
+	float min_x = std::max(b1.min.x(), b2.min.x());
+	float max_x = std::min(b1.max.x(), b2.max.x());
 	if (min_x < max_x)
 	{
-		float min_y = std::max(b1.min.y, b2.min.y);
-		float max_y = std::min(b1.max.y, b2.max.y);
+		float min_y = std::max(b1.min.y(), b2.min.y());
+		float max_y = std::min(b1.max.y(), b2.max.y());
 		return min_y < max_y;
 	}
 	return false;
 }
 
+// @return Return true if the point is inside the bound or on its edge.
+inline bool PointInBound(const Bound& bound, const Vector2& point)
+{
+	return point.x() >= bound.min.x() && point.x() <= bound.max.x() &&
+		point.y() >= bound.min.y() && point.y() <= bound.max.y();
+}
+
+// @return The smallest bound that contains both bounds.
+inline Bound MergeBound(const Bound& b1, const Bound& b2)
+{
+	Bound bound;
+	bound.min = Vector2(std::min(b1.min.x(), b2.min.x()), std::min(b1.min.y(), b2.min.y()));
+	bound.max = Vector2(std::max(b1.max.x(), b2.max.x()), std::max(b1.max.y(), b2.max.y()));
+	return bound;
+}
+
+// @return The bound enlarged by the margin on every side.
+inline Bound ExpandBound(const Bound& bound, float margin)
+{
+	Vector2 v(margin, margin);
+	return Bound{ bound.min - v, bound.max + v };
+}
+
+// Perimeter is used as the cost of a bound in bounding volume hierarchies.
+inline float BoundPerimeter(const Bound& bound)
+{
+	return 2 * ((bound.max.x() - bound.min.x()) + (bound.max.y() - bound.min.y()));
+}
+
 // @return Return true if the x axis is cross the bound.
 inline bool HorizentalAxisCrossBound(const Bound& bound, const float y)
 {
@@ -53,7 +82,7 @@ inline bool HorizentalAxisCrossBound(const Bound& bound, const float y)
 // @return Return true if the y axis is cross the bound.
 inline bool VertivalAxisCrossBound(const Bound& bound, const float x)
 {
-	return x <= bound.max.x() && x >= bound.min.y();
+	return x <= bound.max.x() && x >= bound.min.x();
 }
 
 }
@@ -7,12 +7,17 @@
 #define _VECTOR_2_H_
 
 #include <cmath>
+#include <type_traits>
 
 namespace ysd_phy_2d
 {
 
 /////////////////////////////////////////////////////
 // 2d vector class.
+//
+// Just two floats. The length is not cached, it is
+// computed when asked, so the temporaries of the math
+// cost nothing more than their components.
 /////////////////////////////////////////////////////
 class Vector2;
 class Vector2 final
@@ -22,33 +27,19 @@ public:
 	Vector2() = default;
 
 	Vector2(float x, float y)
-		: x_(x), y_(y),
-		length_(hypotf(x, y)), 		// √x2+y2
-		changed_(false)
+		: x_(x), y_(y)
 	{}
 
 	float x() const { return x_; }
-	void set_x(float v)
-	{
-		x_ = v;
-		changed_ = true;
-	}
+	void set_x(float v) { x_ = v; }
 
 	float y() const { return y_; }
-	void set_y(float v)
-	{
-		y_ = v;
-		changed_ = true;
-	}
+	void set_y(float v) { y_ = v; }
 
+	// √x2+y2, computed on every call.
 	float length() const
 	{
-		if (changed_)
-		{
-			changed_ = false;
-			length_ = hypotf(x_, y_);
-		}
-		return length_;
+		return hypotf(x_, y_);
 	}
 
 	void Scale(const Vector2& vec2)
@@ -66,7 +57,6 @@ public:
 
 	Vector2& operator+= (const Vector2& vec)
 	{
-		changed_ = true;
 		this->x_ += vec.x_;
 		this->y_ += vec.y_;
 		return *this;
@@ -74,7 +64,6 @@ public:
 
 	Vector2& operator-= (const Vector2& vec)
 	{
-		changed_ = true;
 		this->x_ -= vec.x_;
 		this->y_ -= vec.y_;
 		return *this;
@@ -82,7 +71,6 @@ public:
 
 	Vector2& operator*= (float m)
 	{
-		changed_ = true;
 		this->x_ *= m;
 		this->y_ *= m;
 		return *this;
@@ -90,7 +78,6 @@ public:
 
 	Vector2& operator/= (float d)
 	{
-		changed_ = true;
 		if (d == 0)
 			return *this;
 		else
@@ -115,6 +102,14 @@ public:
 		return hypotf(x, y);
 	}
 
+	// Square of the distance, no square root.
+	static float SqrDistance(const Vector2& vec1, const Vector2& vec2)
+	{
+		float x = vec1.x_ - vec2.x_;
+		float y = vec1.y_ - vec2.y_;
+		return x * x + y * y;
+	}
+
 	// Perform a x b x c.
 	// @return A perpendicular vector of c. This vector is still on the plane of abc.
 	static Vector2 TripleCross(const Vector2& a, const Vector2& b, const Vector2& c)
@@ -151,14 +146,13 @@ private:
 
 	float x_;
 	float y_;
-
-	// Length of the vector. It is logic const but not bitwise const.
-	mutable float length_;
-
-	mutable bool changed_;
-
 };
 
+// Vectors are copied and stored in bulk, e.g. in bounds and vertex
+// arrays, they must stay two plain floats.
+static_assert(sizeof(Vector2) == 2 * sizeof(float), "Vector2 must be two floats.");
+static_assert(std::is_trivially_copyable<Vector2>::value, "Vector2 must be trivially copyable.");
+
 inline const Vector2 operator+ (const Vector2& vec1, const Vector2& vec2)
 {
 	float x = vec1.x_ + vec2.x_;
@@ -215,9 +209,10 @@ inline const bool operator< (const Vector2& vec1, const Vector2& vec2)
 	return vec1.x() < vec2.x() && vec1.y() < vec2.y();
 }
 
+// If x/y of vec1 is both bigger than x/y of vec2, vec1 is bigger than vec2.
 inline const bool operator> (const Vector2& vec1, const Vector2& vec2)
 {
-	return (!(vec1 < vec2)) && (vec1 != vec2);
+	return vec2 < vec1;
 }
 
 }
@@ -0,0 +1,367 @@
+#include "aabb-tree.h"
+
+#include <algorithm>
+#include <assert.h>
+
+using namespace ysd_phy_2d;
+
+const int32_t AabbTree::kNullNode;
+
+int32_t AabbTree::AllocateNode()
+{
+	int32_t index;
+	if (free_list_ != kNullNode)
+	{
+		index = free_list_;
+		free_list_ = nodes_[index].parent;
+	}
+	else
+	{
+		index = static_cast<int32_t>(nodes_.size());
+		nodes_.emplace_back();
+	}
+
+	Node& node = nodes_[index];
+	node.parent = kNullNode;
+	node.child1 = kNullNode;
+	node.child2 = kNullNode;
+	node.height = 0;
+	node.handle = kInvalidHandle;
+	return index;
+}
+
+void AabbTree::FreeNode(int32_t index)
+{
+	nodes_[index].parent = free_list_;
+	nodes_[index].height = -1;
+	free_list_ = index;
+}
+
+void AabbTree::Insert(ColliderHandle handle)
+{
+	if (handle >= leaves_.size())
+	{
+		leaves_.resize(handle + 1, kNullNode);
+	}
+	assert(leaves_[handle] == kNullNode);
+
+	int32_t leaf = AllocateNode();
+	nodes_[leaf].bound = ExpandBound(pool_->bound(handle), margin_);
+	nodes_[leaf].handle = handle;
+	InsertLeaf(leaf);
+
+	leaves_[handle] = leaf;
+}
+
+void AabbTree::Remove(ColliderHandle handle)
+{
+	if (handle >= leaves_.size() || leaves_[handle] == kNullNode)
+		return;
+
+	int32_t leaf = leaves_[handle];
+	RemoveLeaf(leaf);
+	FreeNode(leaf);
+	leaves_[handle] = kNullNode;
+}
+
+void AabbTree::Refit(ColliderHandle handle)
+{
+	if (handle >= leaves_.size() || leaves_[handle] == kNullNode)
+		return;
+
+	int32_t leaf = leaves_[handle];
+	const Bound& bound = pool_->bound(handle);
+
+	// Still in the fat bound.
+	if (BoundinBound(nodes_[leaf].bound, bound))
+		return;
+
+	RemoveLeaf(leaf);
+	nodes_[leaf].bound = ExpandBound(bound, margin_);
+	InsertLeaf(leaf);
+}
+
+void AabbTree::InsertLeaf(int32_t leaf)
+{
+	if (root_ == kNullNode)
+	{
+		root_ = leaf;
+		nodes_[root_].parent = kNullNode;
+		return;
+	}
+
+	// Find the best sibling.
+	const Bound leaf_bound = nodes_[leaf].bound;
+	int32_t index = root_;
+	while (!nodes_[index].IsLeaf())
+	{
+		const Node& node = nodes_[index];
+		float perimeter = BoundPerimeter(node.bound);
+		float merged_perimeter = BoundPerimeter(MergeBound(node.bound, leaf_bound));
+
+		// Cost of creating a new parent for this node and the new leaf.
+		float cost = 2 * merged_perimeter;
+
+		// Minimum cost of pushing the leaf further down the tree.
+		float inheritance_cost = 2 * (merged_perimeter - perimeter);
+
+		float child_cost[2];
+		const int32_t children[2] = { node.child1, node.child2 };
+		for (int i = 0; i < 2; ++i)
+		{
+			const Node& child = nodes_[children[i]];
+			float merged = BoundPerimeter(MergeBound(leaf_bound, child.bound));
+			child_cost[i] = (child.IsLeaf() ? merged : merged - BoundPerimeter(child.bound)) + inheritance_cost;
+		}
+
+		if (cost < child_cost[0] && cost < child_cost[1])
+			break;
+
+		index = child_cost[0] < child_cost[1] ? children[0] : children[1];
+	}
+
+	int32_t sibling = index;
+
+	// Create a new parent for the sibling and the leaf.
+	int32_t old_parent = nodes_[sibling].parent;
+	int32_t new_parent = AllocateNode();
+	nodes_[new_parent].parent = old_parent;
+	nodes_[new_parent].bound = MergeBound(leaf_bound, nodes_[sibling].bound);
+	nodes_[new_parent].height = nodes_[sibling].height + 1;
+	nodes_[new_parent].child1 = sibling;
+	nodes_[new_parent].child2 = leaf;
+	nodes_[sibling].parent = new_parent;
+	nodes_[leaf].parent = new_parent;
+
+	if (old_parent != kNullNode)
+	{
+		if (nodes_[old_parent].child1 == sibling)
+			nodes_[old_parent].child1 = new_parent;
+		else
+			nodes_[old_parent].child2 = new_parent;
+	}
+	else
+	{
+		root_ = new_parent;
+	}
+
+	FixUpwards(nodes_[leaf].parent);
+}
+
+void AabbTree::RemoveLeaf(int32_t leaf)
+{
+	if (leaf == root_)
+	{
+		root_ = kNullNode;
+		return;
+	}
+
+	int32_t parent = nodes_[leaf].parent;
+	int32_t grand_parent = nodes_[parent].parent;
+	int32_t sibling = nodes_[parent].child1 == leaf ? nodes_[parent].child2 : nodes_[parent].child1;
+
+	if (grand_parent != kNullNode)
+	{
+		// Replace the parent with the sibling.
+		if (nodes_[grand_parent].child1 == parent)
+			nodes_[grand_parent].child1 = sibling;
+		else
+			nodes_[grand_parent].child2 = sibling;
+		nodes_[sibling].parent = grand_parent;
+		FreeNode(parent);
+
+		FixUpwards(grand_parent);
+	}
+	else
+	{
+		root_ = sibling;
+		nodes_[sibling].parent = kNullNode;
+		FreeNode(parent);
+	}
+}
+
+void AabbTree::FixUpwards(int32_t index)
+{
+	while (index != kNullNode)
+	{
+		index = Balance(index);
+
+		Node& node = nodes_[index];
+		const Node& child1 = nodes_[node.child1];
+		const Node& child2 = nodes_[node.child2];
+		node.height = 1 + std::max(child1.height, child2.height);
+		node.bound = MergeBound(child1.bound, child2.bound);
+
+		index = node.parent;
+	}
+}
+
+int32_t AabbTree::Balance(int32_t ia)
+{
+	Node& a = nodes_[ia];
+	if (a.IsLeaf() || a.height < 2)
+		return ia;
+
+	int32_t ib = a.child1;
+	int32_t ic = a.child2;
+	Node& b = nodes_[ib];
+	Node& c = nodes_[ic];
+
+	int32_t balance = c.height - b.height;
+
+	// Rotate c up.
+	if (balance > 1)
+	{
+		int32_t i_f = c.child1;
+		int32_t ig = c.child2;
+		Node& f = nodes_[i_f];
+		Node& g = nodes_[ig];
+
+		// Swap a and c.
+		c.child1 = ia;
+		c.parent = a.parent;
+		a.parent = ic;
+
+		// a's old parent should point to c.
+		if (c.parent != kNullNode)
+		{
+			if (nodes_[c.parent].child1 == ia)
+				nodes_[c.parent].child1 = ic;
+			else
+				nodes_[c.parent].child2 = ic;
+		}
+		else
+		{
+			root_ = ic;
+		}
+
+		// Keep the higher grandchild under c.
+		if (f.height > g.height)
+		{
+			c.child2 = i_f;
+			a.child2 = ig;
+			g.parent = ia;
+			a.bound = MergeBound(b.bound, g.bound);
+			c.bound = MergeBound(a.bound, f.bound);
+			a.height = 1 + std::max(b.height, g.height);
+			c.height = 1 + std::max(a.height, f.height);
+		}
+		else
+		{
+			c.child2 = ig;
+			a.child2 = i_f;
+			f.parent = ia;
+			a.bound = MergeBound(b.bound, f.bound);
+			c.bound = MergeBound(a.bound, g.bound);
+			a.height = 1 + std::max(b.height, f.height);
+			c.height = 1 + std::max(a.height, g.height);
+		}
+
+		return ic;
+	}
+
+	// Rotate b up.
+	if (balance < -1)
+	{
+		int32_t id = b.child1;
+		int32_t ie = b.child2;
+		Node& d = nodes_[id];
+		Node& e = nodes_[ie];
+
+		// Swap a and b.
+		b.child1 = ia;
+		b.parent = a.parent;
+		a.parent = ib;
+
+		// a's old parent should point to b.
+		if (b.parent != kNullNode)
+		{
+			if (nodes_[b.parent].child1 == ia)
+				nodes_[b.parent].child1 = ib;
+			else
+				nodes_[b.parent].child2 = ib;
+		}
+		else
+		{
+			root_ = ib;
+		}
+
+		// Keep the higher grandchild under b.
+		if (d.height > e.height)
+		{
+			b.child2 = id;
+			a.child1 = ie;
+			e.parent = ia;
+			a.bound = MergeBound(c.bound, e.bound);
+			b.bound = MergeBound(a.bound, d.bound);
+			a.height = 1 + std::max(c.height, e.height);
+			b.height = 1 + std::max(a.height, d.height);
+		}
+		else
+		{
+			b.child2 = ie;
+			a.child1 = id;
+			d.parent = ia;
+			a.bound = MergeBound(c.bound, d.bound);
+			b.bound = MergeBound(a.bound, e.bound);
+			a.height = 1 + std::max(c.height, d.height);
+			b.height = 1 + std::max(a.height, e.height);
+		}
+
+		return ib;
+	}
+
+	return ia;
+}
+
+void AabbTree::QueryPairs(PairBuffer& pairs)
+{
+	pairs.Clear();
+	if (root_ != kNullNode)
+	{
+		QueryPairsInSubtree(root_, pairs);
+	}
+}
+
+void AabbTree::QueryPairsInSubtree(int32_t index, PairBuffer& pairs) const
+{
+	const Node& node = nodes_[index];
+	if (node.IsLeaf())
+		return;
+
+	QueryPairsInSubtree(node.child1, pairs);
+	QueryPairsInSubtree(node.child2, pairs);
+	QueryPairsBetweenSubtrees(node.child1, node.child2, pairs);
+}
+
+void AabbTree::QueryPairsBetweenSubtrees(int32_t index1, int32_t index2, PairBuffer& pairs) const
+{
+	const Node& node1 = nodes_[index1];
+	const Node& node2 = nodes_[index2];
+	if (!BoundContactBound(node1.bound, node2.bound))
+		return;
+
+	if (node1.IsLeaf() && node2.IsLeaf())
+	{
+		// The fat bounds contact, check the real ones.
+		const Bound* bounds = pool_->bounds();
+		if (BoundContactBound(bounds[node1.handle], bounds[node2.handle]))
+		{
+			pairs.Push(node1.handle, node2.handle);
+		}
+		return;
+	}
+
+	// Go down the bigger one.
+	if (node2.IsLeaf() ||
+		(!node1.IsLeaf() && BoundPerimeter(node1.bound) > BoundPerimeter(node2.bound)))
+	{
+		QueryPairsBetweenSubtrees(node1.child1, index2, pairs);
+		QueryPairsBetweenSubtrees(node1.child2, index2, pairs);
+	}
+	else
+	{
+		QueryPairsBetweenSubtrees(index1, node2.child1, pairs);
+		QueryPairsBetweenSubtrees(index1, node2.child2, pairs);
+	}
+}
@@ -0,0 +1,111 @@
+//////////////////////////////////////////////////////////
+// @fileoverview Dynamic AABB tree broad phase.
+// @author	ysd
+//////////////////////////////////////////////////////////
+
+#ifndef _AABB_TREE_H_
+#define _AABB_TREE_H_
+
+#include <vector>
+
+#include "../math/bound.h"
+#include "broad-phase.h"
+
+namespace ysd_phy_2d
+{
+
+/////////////////////////////////////////////////////////
+// A bounding volume hierarchy of AABBs.
+//
+// Every collider is a leaf. A leaf keeps the collider's
+// bound enlarged by a margin, so that the collider is only
+// reinserted when it leaves the fat bound.
+//
+// A new leaf goes down the side that increase the
+// perimeter least, and the tree is kept balanced by
+// rotating the nodes on the way back to the root.
+//
+// Unlike the quad tree it does not need the size of the
+// world.
+/////////////////////////////////////////////////////////
+class AabbTree final : public BroadPhase
+{
+public:
+	// @param[in]	margin	How much a leaf's bound is enlarged on every side.
+	AabbTree(ColliderPool* pool, float margin = 1)
+		: BroadPhase(pool), margin_(margin)
+	{}
+
+	void Insert(ColliderHandle handle) override;
+
+	void Remove(ColliderHandle handle) override;
+
+	// Reinsert the collider if it leaves its fat bound.
+	void Refit(ColliderHandle handle) override;
+
+	void QueryPairs(PairBuffer& pairs) override;
+
+	// Height of the tree. A single leaf is zero.
+	int32_t height() const
+	{
+		return root_ == kNullNode ? 0 : nodes_[root_].height;
+	}
+
+	float margin() const { return margin_; }
+
+private:
+	static const int32_t kNullNode = -1;
+
+	struct Node
+	{
+		// Fat bound for a leaf, union of the children otherwise.
+		Bound bound;
+
+		// The next free node when the node is in the free list.
+		int32_t parent;
+
+		int32_t child1;
+		int32_t child2;
+
+		// Leaf is 0, free node is -1.
+		int32_t height;
+
+		// Only valid for a leaf.
+		ColliderHandle handle;
+
+		bool IsLeaf() const { return child1 == kNullNode; }
+	};
+
+	int32_t AllocateNode();
+	void FreeNode(int32_t index);
+
+	void InsertLeaf(int32_t leaf);
+	void RemoveLeaf(int32_t leaf);
+
+	// Rotate the node if its children's heights differ by more than one.
+	// @return	The node that takes the place of the given node.
+	int32_t Balance(int32_t index);
+
+	// Walk up from the node, rebalance and refresh the bounds and heights.
+	void FixUpwards(int32_t index);
+
+	// Collect the pairs between the leaves of a subtree.
+	void QueryPairsInSubtree(int32_t index, PairBuffer& pairs) const;
+
+	// Collect the pairs between the leaves of two disjoint subtrees.
+	// The bigger subtree is split first.
+	void QueryPairsBetweenSubtrees(int32_t index1, int32_t index2, PairBuffer& pairs) const;
+
+	float margin_;
+
+	std::vector<Node> nodes_;
+	int32_t root_ = kNullNode;
+	int32_t free_list_ = kNullNode;
+
+	// Leaf node of every collider, indexed by handle.
+	std::vector<int32_t> leaves_;
+};
+
+}
+
+#endif
@@ -0,0 +1,115 @@
+//////////////////////////////////////////////////////////
+// @fileoverview Common interface of the broad phase
+//				 structures.
+// @author	ysd
+//////////////////////////////////////////////////////////
+
+#ifndef _BROAD_PHASE_H_
+#define _BROAD_PHASE_H_
+
+#include "../math/vector_2.h"
+#include "../common/un-copy-move-interface.h"
+#include "collider-pool.h"
+#include "collider-pair.h"
+
+namespace ysd_phy_2d
+{
+
+class ThreadPool;
+
+// Kinds of broad phase the world can be created with.
+enum BroadPhaseType
+{
+	kQuadTreeBroadPhase = 0,
+	kSweepAndPruneBroadPhase = 1,
+	kAabbTreeBroadPhase = 2,
+	kSpatialHashBroadPhase = 3
+};
+
+/////////////////////////////////////////////////////////
+// A BroadPhase index the bounds of the colliders in a
+// pool and find the pairs whose bounds contact.
+//
+// A collider is transformed through the broad phase, so
+// that the index can be fixed up after the bound in the
+// pool changed.
+/////////////////////////////////////////////////////////
+class BroadPhase : public IUncopyable
+{
+public:
+	// @param[in]	pool	Storage of the colliders. Not owned.
+	explicit BroadPhase(ColliderPool* pool)
+		: pool_(pool)
+	{}
+
+	virtual ~BroadPhase() = default;
+
+	// Insert a collider of the pool.
+	virtual void Insert(ColliderHandle handle) = 0;
+
+	// Insert many colliders of the pool at once, e.g. when a level is
+	// loaded. A broad phase may index the batch faster than one by one.
+	virtual void InsertBatch(const ColliderHandle* handles, std::size_t count)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			Insert(handles[i]);
+		}
+	}
+
+	// Remove a collider. The collider is still in the pool.
+	virtual void Remove(ColliderHandle handle) = 0;
+
+	// The bound of a collider in the pool has changed.
+	virtual void Refit(ColliderHandle handle) = 0;
+
+	// The bounds of many colliders have changed, e.g. all colliders moved
+	// in a frame. Every handle is only given once.
+	virtual void RefitBatch(const ColliderHandle* handles, std::size_t count)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			Refit(handles[i]);
+		}
+	}
+
+	// Find all pairs of colliders whose bounds contact.
+	// @param[out]	pairs	Cleared and filled with the candidate pairs.
+	virtual void QueryPairs(PairBuffer& pairs) = 0;
+
+	void Move(ColliderHandle handle, const Vector2& movement)
+	{
+		pool_->Translate(handle, movement);
+		Refit(handle);
+	}
+
+	void Scale(ColliderHandle handle, const Vector2& scale)
+	{
+		pool_->ScaleFor(handle, scale);
+		Refit(handle);
+	}
+
+	void Rotate(ColliderHandle handle, const float angle)
+	{
+		pool_->Rotate(handle, angle);
+		Refit(handle);
+	}
+
+	const ColliderPool* pool() const { return pool_; }
+
+	// Let the broad phase split its work over the threads of a pool. The
+	// results are the same whatever the number of threads.
+	// @param[in]	threads	Not owned. Null to work on the calling thread only.
+	void set_thread_pool(ThreadPool* threads) { threads_ = threads; }
+
+protected:
+	// Not owned.
+	ColliderPool* pool_;
+
+	// Not owned, may be null.
+	ThreadPool* threads_ = nullptr;
+};
+
+}
+
+#endif
@@ -0,0 +1,78 @@
+//////////////////////////////////////////////////////////
+// @fileoverview Candidate pairs produced by broad phase.
+// @author	ysd
+//////////////////////////////////////////////////////////
+
+#ifndef _COLLIDER_PAIR_H_
+#define _COLLIDER_PAIR_H_
+
+#include <vector>
+#include <cstddef>
+
+#include "../common/un-copy-move-interface.h"
+#include "collider-pool.h"
+
+namespace ysd_phy_2d
+{
+
+// Two colliders whose bounds contact each other.
+// They may collide and need to be checked in narrow phase.
+struct ColliderPair
+{
+	ColliderHandle first;
+	ColliderHandle second;
+};
+
+/////////////////////////////////////////////////////////
+// A PairBuffer hold the candidate pairs of one frame.
+//
+// The buffer is reused every frame. Clear() only reset
+// the size, the memory is kept so that there is no
+// allocation after the buffer reach the working size of
+// the scene.
+/////////////////////////////////////////////////////////
+class PairBuffer final : public IUncopyable
+{
+public:
+	static const std::size_t kDefaultCapacity = 1 << 16;
+
+	explicit PairBuffer(std::size_t capacity = kDefaultCapacity)
+	{
+		pairs_.reserve(capacity);
+	}
+
+	void Clear()
+	{
+		pairs_.clear();
+	}
+
+	void Push(ColliderHandle first, ColliderHandle second)
+	{
+		pairs_.push_back(ColliderPair{ first, second });
+	}
+
+	// Copy the pairs of another buffer to the end.
+	void Append(const PairBuffer& other)
+	{
+		pairs_.insert(pairs_.end(), other.pairs_.begin(), other.pairs_.end());
+	}
+
+	std::size_t size() const { return pairs_.size(); }
+	bool empty() const { return pairs_.empty(); }
+
+	const ColliderPair& operator[](std::size_t i) const
+	{
+		return pairs_[i];
+	}
+
+	// Batch access for narrow phase.
+	const ColliderPair* begin() const { return pairs_.data(); }
+	const ColliderPair* end() const { return pairs_.data() + pairs_.size(); }
+
+private:
+	std::vector<ColliderPair> pairs_;
+};
+
+}
+
+#endif
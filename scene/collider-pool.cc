@@ -0,0 +1,99 @@
+#include "collider-pool.h"
+
+#include <algorithm>
+
+using namespace ysd_phy_2d;
+
+ColliderHandle ColliderPool::Add(std::unique_ptr<BaseCollider> collider)
+{
+	assert(Find(collider->id()) == kInvalidHandle);
+
+	ColliderHandle handle;
+	if (!free_handles_.empty())
+	{
+		// Reuse a free slot.
+		handle = free_handles_.back();
+		free_handles_.pop_back();
+	}
+	else
+	{
+		assert(colliders_.size() < kInvalidHandle);
+
+		handle = static_cast<ColliderHandle>(colliders_.size());
+		bounds_.emplace_back();
+		positions_.emplace_back();
+		scales_.emplace_back();
+		angles_.emplace_back();
+		types_.emplace_back();
+		radii_.emplace_back();
+		ids_.emplace_back();
+		continuous_.emplace_back();
+		sweep_starts_.emplace_back();
+		start_bounds_.emplace_back();
+		sweeps_.emplace_back();
+		colliders_.emplace_back();
+	}
+
+	ids_[handle] = collider->id();
+	continuous_[handle] = 0;
+	sweeps_[handle] = Vector2::kZero;
+	if (collider->id() >= handles_.size())
+	{
+		handles_.resize(collider->id() + 1, kInvalidHandle);
+	}
+	handles_[collider->id()] = handle;
+	++size_;
+	colliders_[handle] = std::move(collider);
+	Sync(handle);
+
+	return handle;
+}
+
+void ColliderPool::Remove(ColliderHandle handle)
+{
+	assert(colliders_[handle] != nullptr);
+
+	if (continuous_[handle])
+	{
+		SetContinuous(handle, false);
+	}
+
+	handles_[ids_[handle]] = kInvalidHandle;
+	--size_;
+	colliders_[handle].reset();
+	free_handles_.push_back(handle);
+}
+
+void ColliderPool::SetContinuous(ColliderHandle handle, bool continuous)
+{
+	if (continuous && !continuous_[handle])
+	{
+		continuous_handles_.push_back(handle);
+	}
+	else if (!continuous && continuous_[handle])
+	{
+		auto it = std::find(continuous_handles_.begin(), continuous_handles_.end(), handle);
+		*it = continuous_handles_.back();
+		continuous_handles_.pop_back();
+	}
+
+	continuous_[handle] = continuous ? 1 : 0;
+	sweep_starts_[handle] = colliders_[handle]->position();
+	start_bounds_[handle] = colliders_[handle]->bound();
+	sweeps_[handle] = Vector2::kZero;
+	Sync(handle);
+}
+
+void ColliderPool::EndSweeps(std::vector<ColliderHandle>* moved)
+{
+	for (ColliderHandle handle : continuous_handles_)
+	{
+		if (sweeps_[handle] == Vector2::kZero)
+			continue;
+
+		sweep_starts_[handle] = colliders_[handle]->position();
+		start_bounds_[handle] = colliders_[handle]->bound();
+		Sync(handle);
+		moved->push_back(handle);
+	}
+}
@@ -0,0 +1,173 @@
+//////////////////////////////////////////////////////////
+// @fileoverview Dense storage of all colliders in the
+//				 physics world.
+// @author	ysd
+//////////////////////////////////////////////////////////
+
+#ifndef _COLLIDER_POOL_H_
+#define _COLLIDER_POOL_H_
+
+#include <vector>
+#include <memory>
+#include <assert.h>
+
+#include "../math/vector_2.h"
+#include "../math/bound.h"
+#include "../colliders/collider.h"
+#include "../common/un-copy-move-interface.h"
+
+namespace ysd_phy_2d
+{
+
+// Index of a collider in the pool.
+typedef uint16_t ColliderHandle;
+const ColliderHandle kInvalidHandle = 0xffff;
+
+/////////////////////////////////////////////////////////
+// A ColliderPool own all colliders in a scene.
+//
+// The transform and the bound that broad phase needs are
+// kept in parallel arrays indexed by the collider's handle,
+// so a scan over bounds touches contiguous memory instead
+// of chasing a pointer to every collider.
+//
+// The collider objects are still needed by narrow phase,
+// the arrays are refreshed whenever a collider is moved,
+// scaled or rotated through the pool.
+//
+// The handle of a removed collider is reused by the next
+// added collider.
+/////////////////////////////////////////////////////////
+class ColliderPool final : public IUncopyable
+{
+public:
+	ColliderPool() = default;
+
+	// Take the ownership of a collider.
+	// @return	The handle of the collider.
+	ColliderHandle Add(std::unique_ptr<BaseCollider> collider);
+
+	// Destroy the collider and free its handle.
+	void Remove(ColliderHandle handle);
+
+	// @return	The handle of the collider with the given id, or kInvalidHandle.
+	ColliderHandle Find(uint16_t id) const
+	{
+		return id < handles_.size() ? handles_[id] : kInvalidHandle;
+	}
+
+	void Translate(ColliderHandle handle, const Vector2& movement)
+	{
+		colliders_[handle]->Translate(movement);
+		Sync(handle);
+	}
+
+	void ScaleFor(ColliderHandle handle, const Vector2& scale)
+	{
+		colliders_[handle]->ScaleFor(scale);
+		Sync(handle);
+	}
+
+	void Rotate(ColliderHandle handle, float angle)
+	{
+		colliders_[handle]->Rotate(angle);
+		Sync(handle);
+	}
+
+	void SetTransform(ColliderHandle handle, const Vector2& position, float angle, const Vector2& scale)
+	{
+		colliders_[handle]->SetTransform(position, angle, scale);
+		Sync(handle);
+	}
+
+	// Let a fast collider sweep: its bound covers its bounds at the start
+	// and at the end of the step, and narrow phase finds the time it hits
+	// the others along the way. The step starts now.
+	void SetContinuous(ColliderHandle handle, bool continuous);
+
+	// Start a new step for all continuous colliders that moved.
+	// @param[out]	moved	The moved colliders, their bounds shrink back.
+	void EndSweeps(std::vector<ColliderHandle>* moved);
+
+	BaseCollider* collider(ColliderHandle handle) const { return colliders_[handle].get(); }
+	uint16_t id(ColliderHandle handle) const { return ids_[handle]; }
+	const Bound& bound(ColliderHandle handle) const { return bounds_[handle]; }
+	const Vector2& position(ColliderHandle handle) const { return positions_[handle]; }
+	const Vector2& scale(ColliderHandle handle) const { return scales_[handle]; }
+	float angle(ColliderHandle handle) const { return angles_[handle]; }
+	ColliderType type(ColliderHandle handle) const { return types_[handle]; }
+
+	bool continuous(ColliderHandle handle) const { return continuous_[handle] != 0; }
+
+	// Translation of a continuous collider since the start of the step,
+	// zero for the others.
+	const Vector2& sweep(ColliderHandle handle) const { return sweeps_[handle]; }
+
+	// Radius in world space of a circle collider, zero for the others.
+	float radius(ColliderHandle handle) const { return radii_[handle]; }
+
+	// Bounds of all handles, including the free ones.
+	const Bound* bounds() const { return bounds_.data(); }
+
+	// Number of handles, including the free ones.
+	std::size_t capacity() const { return colliders_.size(); }
+
+	// Number of live colliders.
+	std::size_t size() const { return size_; }
+
+private:
+	// Copy the transform and bound of a collider into the arrays.
+	void Sync(ColliderHandle handle)
+	{
+		const BaseCollider* collider = colliders_[handle].get();
+		positions_[handle] = collider->position();
+		scales_[handle] = collider->scale();
+		angles_[handle] = collider->angle();
+		bounds_[handle] = collider->bound();
+		types_[handle] = collider->type();
+		radii_[handle] = types_[handle] == kCircleColliderType ?
+			static_cast<const CircleCollider*>(collider)->Radius() : 0;
+
+		if (continuous_[handle])
+		{
+			sweeps_[handle] = positions_[handle] - sweep_starts_[handle];
+			bounds_[handle] = MergeBound(start_bounds_[handle], bounds_[handle]);
+		}
+	}
+
+	// Hot data of the colliders.
+	std::vector<Bound> bounds_;
+	std::vector<Vector2> positions_;
+	std::vector<Vector2> scales_;
+	std::vector<float> angles_;
+	std::vector<ColliderType> types_;
+	std::vector<float> radii_;
+	std::vector<uint16_t> ids_;
+
+	// Sweeps of the continuous colliders. Where they started the step and
+	// how far they moved since.
+	std::vector<uint8_t> continuous_;
+	std::vector<Vector2> sweep_starts_;
+	std::vector<Bound> start_bounds_;
+	std::vector<Vector2> sweeps_;
+
+	// Handles of the continuous colliders.
+	std::vector<ColliderHandle> continuous_handles_;
+
+	// The colliders, used by narrow phase.
+	std::vector<std::unique_ptr<BaseCollider>> colliders_;
+
+	// Handles that can be reused.
+	std::vector<ColliderHandle> free_handles_;
+
+	// Handle of every id, kInvalidHandle if there is no collider of the
+	// id. The ids are 16 bits, a flat table is a lookup with no hashing.
+	std::vector<ColliderHandle> handles_;
+
+	// Number of the colliders.
+	std::size_t size_ = 0;
+};
+
+}
+
+#endif
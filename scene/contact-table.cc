@@ -0,0 +1,104 @@
+#include "contact-table.h"
+
+using namespace ysd_phy_2d;
+
+const uint32_t ContactTable::kEmptyKey;
+
+ContactTable::ContactTable(std::size_t capacity)
+{
+	// Keep the table at most half full.
+	std::size_t size = 64;
+	while (size < capacity * 2)
+		size *= 2;
+
+	slots_.assign(size, Slot{ kEmptyKey, 0, 0 });
+	mask_ = static_cast<uint32_t>(size - 1);
+	live_.reserve(capacity);
+}
+
+bool ContactTable::Touch(uint16_t id1, uint16_t id2)
+{
+	uint32_t key = Key(id1, id2);
+	uint32_t slot = Home(key);
+	for (;;)
+	{
+		Slot& entry = slots_[slot];
+		if (entry.key == key)
+		{
+			// Touched in the last frame, or already in this one.
+			bool entered = entry.frame != frame_ - 1 && entry.frame != frame_;
+			entry.frame = frame_;
+			return entered;
+		}
+
+		if (entry.key == kEmptyKey)
+			break;
+
+		slot = (slot + 1) & mask_;
+	}
+
+	if ((live_.size() + 1) * 2 > slots_.size())
+	{
+		Grow();
+		return Touch(id1, id2);
+	}
+
+	Slot& entry = slots_[slot];
+	entry.key = key;
+	entry.frame = frame_;
+	entry.live_index = static_cast<uint32_t>(live_.size());
+	live_.push_back(slot);
+	return true;
+}
+
+void ContactTable::Erase(uint32_t slot)
+{
+	// Swap with the last live slot and pop.
+	uint32_t live_index = slots_[slot].live_index;
+	uint32_t last = live_.back();
+	live_[live_index] = last;
+	slots_[last].live_index = live_index;
+	live_.pop_back();
+
+	// Shift back the following entries that can not be found without
+	// passing the hole.
+	uint32_t hole = slot;
+	uint32_t next = slot;
+	for (;;)
+	{
+		next = (next + 1) & mask_;
+		const Slot& entry = slots_[next];
+		if (entry.key == kEmptyKey)
+			break;
+
+		// The entry stays if its home is cyclically in (hole, next].
+		uint32_t home = Home(entry.key);
+		bool stays = hole <= next ? (home > hole && home <= next) : (home > hole || home <= next);
+		if (stays)
+			continue;
+
+		slots_[hole] = entry;
+		live_[entry.live_index] = hole;
+		hole = next;
+	}
+	slots_[hole].key = kEmptyKey;
+}
+
+void ContactTable::Grow()
+{
+	std::vector<Slot> old;
+	old.swap(slots_);
+	slots_.assign(old.size() * 2, Slot{ kEmptyKey, 0, 0 });
+	mask_ = static_cast<uint32_t>(slots_.size() - 1);
+
+	for (uint32_t& live_slot : live_)
+	{
+		const Slot& entry = old[live_slot];
+		uint32_t slot = Home(entry.key);
+		while (slots_[slot].key != kEmptyKey)
+			slot = (slot + 1) & mask_;
+
+		slots_[slot] = entry;
+		live_slot = slot;
+	}
+}
@@ -0,0 +1,118 @@
+//////////////////////////////////////////////////////////
+// @fileoverview Persistent table of the touching pairs,
+//				 to tell enter, stay and exit apart.
+// @author	ysd
+//////////////////////////////////////////////////////////
+
+#ifndef _CONTACT_TABLE_H_
+#define _CONTACT_TABLE_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+#include "../common/un-copy-move-interface.h"
+
+namespace ysd_phy_2d
+{
+
+/////////////////////////////////////////////////////////
+// A ContactTable remember the pairs of colliders that
+// touched in the last frame.
+//
+// A pair is keyed by the two ids packed in 32 bits, in an
+// open addressing table with linear probing. Every entry
+// is stamped with the last frame it touched, a pair
+// touched this frame but not in the last one has just
+// entered, and a pair not touched this frame has exited.
+//
+// The live entries are also listed densely, so finding
+// the exited pairs is one pass over the live pairs rather
+// than over the table. An entry is erased by shifting the
+// following entries back, there is no tombstone and the
+// table is never rehashed unless it grows.
+/////////////////////////////////////////////////////////
+class ContactTable final : public IUncopyable
+{
+public:
+	// @param[in]	capacity	Pairs the table holds without growing.
+	explicit ContactTable(std::size_t capacity = 1024);
+
+	// Start a new frame.
+	void BeginFrame() { ++frame_; }
+
+	// A pair touches in this frame.
+	// @return	True if the pair did not touch in the last frame.
+	bool Touch(uint16_t id1, uint16_t id2);
+
+	// Erase the pairs that did not touch in this frame.
+	// @param[in]	on_exit		Called with the ids of every erased pair.
+	template <typename F>
+	void EndFrame(F&& on_exit)
+	{
+		for (std::size_t i = 0; i < live_.size();)
+		{
+			uint32_t slot = live_[i];
+			if (slots_[slot].frame == frame_)
+			{
+				++i;
+				continue;
+			}
+
+			uint32_t key = slots_[slot].key;
+			Erase(slot);
+			on_exit(static_cast<uint16_t>(key >> 16), static_cast<uint16_t>(key & 0xffff));
+		}
+	}
+
+	// Number of the touching pairs.
+	std::size_t size() const { return live_.size(); }
+
+	std::size_t capacity() const { return slots_.size() / 2; }
+
+private:
+	static const uint32_t kEmptyKey = 0xffffffff;
+
+	struct Slot
+	{
+		uint32_t key;
+
+		// The last frame the pair touched.
+		uint32_t frame;
+
+		// Index of the slot in live_.
+		uint32_t live_index;
+	};
+
+	static uint32_t Key(uint16_t id1, uint16_t id2)
+	{
+		if (id1 > id2)
+			std::swap(id1, id2);
+		return (static_cast<uint32_t>(id1) << 16) | id2;
+	}
+
+	uint32_t Home(uint32_t key) const
+	{
+		// Fibonacci hashing.
+		return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask_;
+	}
+
+	// Remove an entry and shift the entries after it back.
+	void Erase(uint32_t slot);
+
+	// Double the table.
+	void Grow();
+
+	std::vector<Slot> slots_;
+	uint32_t mask_ = 0;
+
+	// Slots of the live pairs.
+	std::vector<uint32_t> live_;
+
+	uint32_t frame_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////
+// @fileoverview Contact events of a frame, grouped by
+//				 kind.
+// @author	ysd
+//////////////////////////////////////////////////////////
+
+#ifndef _EVENT_STREAM_H_
+#define _EVENT_STREAM_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "../colliders/collider.h"
+#include "../common/span.h"
+#include "../common/un-copy-move-interface.h"
+
+namespace ysd_phy_2d
+{
+
+// A contact event of two colliders.
+struct ContactEvent
+{
+	static const uint32_t kNoCollision = 0xffffffff;
+
+	// Ids of the two colliders.
+	uint16_t first;
+	uint16_t second;
+
+	// Index of the contact data in the frame's collisions, kNoCollision
+	// for an exit event.
+	uint32_t collision;
+};
+
+/////////////////////////////////////////////////////////
+// An EventStream collect the contact events of a frame,
+// every kind in its own contiguous buffer, so that the
+// events can be handled in bulk after the step instead
+// of by a callback per event.
+//
+// The buffers are reused every frame.
+/////////////////////////////////////////////////////////
+class EventStream final : public IUncopyable
+{
+public:
+	static const std::size_t kDefaultCapacity = 1 << 12;
+
+	explicit EventStream(std::size_t capacity = kDefaultCapacity)
+	{
+		for (std::vector<ContactEvent>& events : events_)
+			events.reserve(capacity);
+	}
+
+	void Clear()
+	{
+		for (std::vector<ContactEvent>& events : events_)
+			events.clear();
+	}
+
+	void Push(OnDetectedCallbackType type, uint16_t first, uint16_t second, uint32_t collision)
+	{
+		events_[type - 1].push_back(ContactEvent{ first, second, collision });
+	}
+
+	// Events of a kind in this frame.
+	Span<const ContactEvent> events(OnDetectedCallbackType type) const
+	{
+		const std::vector<ContactEvent>& events = events_[type - 1];
+		return Span<const ContactEvent>(events.data(), events.size());
+	}
+
+	// Number of events of all kinds.
+	std::size_t size() const
+	{
+		return events_[0].size() + events_[1].size() + events_[2].size();
+	}
+
+	// Hand all events to a visitor, the enter events first, then the stay
+	// ones and the exit ones, then clear the stream. The visitor has
+	//   void OnEnter(const ContactEvent&);
+	//   void OnStay(const ContactEvent&);
+	//   void OnExit(const ContactEvent&);
+	// The calls are resolved at compile time and can be inlined.
+	template <typename Visitor>
+	void Drain(Visitor& visitor)
+	{
+		for (const ContactEvent& event : events_[kOnColliderEnter - 1])
+			visitor.OnEnter(event);
+		for (const ContactEvent& event : events_[kOnColliderStay - 1])
+			visitor.OnStay(event);
+		for (const ContactEvent& event : events_[kOnColliderExit - 1])
+			visitor.OnExit(event);
+		Clear();
+	}
+
+private:
+	// Indexed by OnDetectedCallbackType - 1.
+	std::vector<ContactEvent> events_[3];
+};
+
+}
+
+#endif
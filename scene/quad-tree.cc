@@ -1,54 +1,281 @@
 #include "quad-tree.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "../common/thread-pool.h"
+
 using namespace ysd_phy_2d;
 
-void QuadTree::Insert(const std::shared_ptr<BaseCollider> collider)
+const uint8_t QuadTree::kMaxBatchDeep;
+const uint8_t QuadTree::kDefaultTaskDeep;
+
+void QuadTree::Insert(ColliderHandle handle)
+{
+	if (handle >= locations_.size())
+	{
+		locations_.resize(handle + 1, Location{ nullptr, 0, false });
+	}
+
+	locations_[handle].inserted = true;
+	InsertNode(handle, root_);
+}
+
+namespace
+{
+
+// Put a zero bit before every bit of a 16 bits value.
+inline uint32_t SpreadBits(uint32_t v)
+{
+	v &= 0x0000ffff;
+	v = (v | (v << 8)) & 0x00ff00ff;
+	v = (v | (v << 4)) & 0x0f0f0f0f;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+// Cell of a coordinate in a grid of the given number of cells.
+inline uint32_t Quantize(float v, float min, float scale, uint32_t cells)
+{
+	float q = std::floor((v - min) * scale);
+	if (q <= 0)
+		return 0;
+	if (q >= cells - 1)
+		return cells - 1;
+	return static_cast<uint32_t>(q);
+}
+
+}
+
+QuadTree::BatchEntry QuadTree::BatchTarget(ColliderHandle handle, uint8_t deep) const
+{
+	const Bound& bound = pool_->bound(handle);
+	const Bound& root_bound = root_->bound;
+	const uint32_t cells = 1u << deep;
+	const float width = root_bound.max.x() - root_bound.min.x();
+	const float length = root_bound.max.y() - root_bound.min.y();
+	const float scale_x = cells / width;
+	const float scale_y = cells / length;
+
+	BatchEntry entry;
+	entry.handle = handle;
+
+	if (!loose())
+	{
+		// The collider goes down as long as the min and max corners are in
+		// the same child, that is the common prefix of their codes.
+		uint32_t min_key = SpreadBits(Quantize(bound.min.x(), root_bound.min.x(), scale_x, cells)) |
+			(SpreadBits(Quantize(bound.min.y(), root_bound.min.y(), scale_y, cells)) << 1);
+		uint32_t max_key = SpreadBits(Quantize(bound.max.x(), root_bound.min.x(), scale_x, cells)) |
+			(SpreadBits(Quantize(bound.max.y(), root_bound.min.y(), scale_y, cells)) << 1);
+
+		uint8_t common = deep;
+		uint32_t diff = min_key ^ max_key;
+		while (diff != 0)
+		{
+			diff >>= 2;
+			--common;
+		}
+		entry.deep = common;
+		entry.key = common == 0 ? 0 : min_key & ~((1u << (2 * (deep - common))) - 1);
+		return entry;
+	}
+
+	// A loose child holds any collider whose center is in its cell and
+	// whose half size is not bigger than the cell's enlarged margin.
+	Vector2 center = (bound.max + bound.min) / 2;
+	float half_x = (bound.max.x() - bound.min.x()) / 2;
+	float half_y = (bound.max.y() - bound.min.y()) / 2;
+	float margin = (looseness_ - 1) / 2;
+
+	uint8_t common = 0;
+	float cell_x = width / 2, cell_y = length / 2;
+	while (common < deep && half_x <= cell_x * margin && half_y <= cell_y * margin)
+	{
+		++common;
+		cell_x /= 2;
+		cell_y /= 2;
+	}
+
+	// A collider near the center of its cell may go one level deeper.
+	if (common < deep)
+		++common;
+
+	uint32_t key = SpreadBits(Quantize(center.x(), root_bound.min.x(), scale_x, cells)) |
+		(SpreadBits(Quantize(center.y(), root_bound.min.y(), scale_y, cells)) << 1);
+	entry.deep = common;
+	entry.key = common == 0 ? 0 : key & ~((1u << (2 * (deep - common))) - 1);
+	return entry;
+}
+
+void QuadTree::InsertBatch(const ColliderHandle* handles, std::size_t count)
 {
-	InsertNode(collider, root_.get());
+	const uint8_t deep = std::min(max_deep_, kMaxBatchDeep);
+
+	batch_.clear();
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		ColliderHandle handle = handles[i];
+		if (handle >= locations_.size())
+		{
+			locations_.resize(handle + 1, Location{ nullptr, 0, false });
+		}
+		locations_[handle].inserted = true;
+
+		if (!BoundinBound(root_->loose_bound, pool_->bound(handle)))
+		{
+			// Out of the world, or on its edge.
+			InsertNode(handle, root_);
+			continue;
+		}
+		batch_.push_back(BatchTarget(handle, deep));
+	}
+
+	// Colliders in the same subtree are next to each other, a parent
+	// comes before its children.
+	std::sort(batch_.begin(), batch_.end(), [](const BatchEntry& e1, const BatchEntry& e2) {
+		return e1.key != e2.key ? e1.key < e2.key : e1.deep < e2.deep;
+	});
+
+	// Nodes from the root down to the previous collider's node. The
+	// first valid_deep + 1 of them are still valid.
+	TreeNode* path[kMaxBatchDeep + 1];
+	path[0] = root_;
+	uint8_t valid_deep = 0;
+	uint32_t last_key = 0;
+
+	for (const BatchEntry& entry : batch_)
+	{
+		// Keep the part of the path shared with the previous collider.
+		uint8_t shared = deep;
+		uint32_t diff = entry.key ^ last_key;
+		while (diff != 0)
+		{
+			diff >>= 2;
+			--shared;
+		}
+		uint8_t d = std::min(std::min(shared, valid_deep), entry.deep);
+
+		for (; d < entry.deep; ++d)
+		{
+			// Child of the cell at the next level. The x bit is the lower one.
+			uint32_t bits = (entry.key >> (2 * (deep - d - 1))) & 3;
+			uint8_t qr = (bits & 2) ? ((bits & 1) ? 0 : 1) : ((bits & 1) ? 3 : 2);
+
+			TreeNode* parent = path[d];
+			if (parent->children[qr] == nullptr)
+			{
+				CreateChild(parent, qr, CreateBound(parent, qr));
+			}
+			path[d + 1] = parent->children[qr];
+		}
+
+		// The cell is only a guess from the quantized bound. Go up until
+		// the node really holds the collider.
+		TreeNode* target = path[entry.deep];
+		TreeNode* node = target;
+		const Bound& bound = pool_->bound(entry.handle);
+		while (node != root_ && !BoundinBound(node->loose_bound, bound))
+		{
+			node = node->parent;
+		}
+		AddToNode(entry.handle, node);
+
+		valid_deep = entry.deep;
+		if (node != target)
+		{
+			Collapse(target);
+			valid_deep = node->deep;
+		}
+		last_key = entry.key;
+	}
 }
 
 // Note that this function must not delete root.
-bool QuadTree::InsertNode(const std::shared_ptr<BaseCollider> collider, TreeNode* root, uint8_t deep = 0)
+bool QuadTree::InsertNode(ColliderHandle handle, TreeNode* root, uint8_t deep)
 {
+	const Bound& bound = pool_->bound(handle);
+
 	// The collider is in the rectangle bound.
-	if (BoundinBound(root->bound, collider->bound()))
+	if (BoundinBound(root->loose_bound, bound))
 	{
 		// If reach the max deep
 		if (deep >= max_deep_)
 		{
 			// The collider is belong to this root area.
-			// Push back the copy of the shared pointer.
-			root->colliders.push_back(collider);
+			AddToNode(handle, root);
 			return true;
 		}
 
+		// A loose tree put the collider in the child that holds its center,
+		// as long as the child's loose bound is big enough.
+		if (loose())
+		{
+			int8_t qr = LooseQuadrant(root, bound);
+			if (qr < 0)
+			{
+				// Too big for the children.
+				AddToNode(handle, root);
+				return true;
+			}
+
+			if (root->children[qr] == nullptr)
+			{
+				CreateChild(root, qr, CreateBound(root, qr));
+			}
+			return InsertNode(handle, root->children[qr], deep + 1);
+		}
+
 		// If the axis go across the bound.
 		const Bound& root_bound = root->bound;
 		Vector2 center = (root_bound.max + root_bound.min) / 2;
-		if (VertivalAxisCrossBound(collider->bound(), center.x()) ||
-			HorizentalAxisCrossBound(collider->bound(), center.y()))
+		if (VertivalAxisCrossBound(bound, center.x()) ||
+			HorizentalAxisCrossBound(bound, center.y()))
 		{
 			// The collider is belong to this root area.
-			// Push back the copy of the shared pointer.
-			root->colliders.push_back(collider);
+			AddToNode(handle, root);
 			return true;
 		}
 
 		// Insert the node in one of four child nodes.
-		InsertNodeInChildren(collider, root, deep);
-
+		if (!InsertNodeInChildren(handle, root, deep))
+		{
+			// It lies on the edge of a child. Keep it here.
+			AddToNode(handle, root);
+		}
+		return true;
 	}
-	else if (deep == 0 && BoundContactBound(collider->bound, root->bound))
+	else if (deep == 0)
 	{
-		// The collider is belong to this root area.
-		// Push back the copy of the shared pointer.
-		root->colliders.push_back(collider);
+		// On the edge of the world or out of it. The root holds it, it is
+		// checked against all the others like the big colliders.
+		AddToNode(handle, root);
 		return true;
 	}
 
 	return false;
 }
 
+int8_t QuadTree::LooseQuadrant(const TreeNode* root, const Bound& bound) const
+{
+	const Bound& root_bound = root->bound;
+	Vector2 center = (root_bound.max + root_bound.min) / 2;
+	Vector2 collider_center = (bound.max + bound.min) / 2;
+
+	// Space partition, see the comment of the class.
+	int8_t qr;
+	if (collider_center.y() >= center.y())
+		qr = collider_center.x() >= center.x() ? 0 : 1;
+	else
+		qr = collider_center.x() >= center.x() ? 3 : 2;
+
+	const TreeNode* child = root->children[qr];
+	const Bound loose_bound = child != nullptr ? child->loose_bound : LooseBound(CreateBound(root, qr));
+	return BoundinBound(loose_bound, bound) ? qr : -1;
+}
+
 inline const Bound QuadTree::CreateBound(const TreeNode* root, uint8_t qr) const
 {
 	assert(qr <= 3);
@@ -75,257 +302,841 @@ inline const Bound QuadTree::CreateBound(const TreeNode* root, uint8_t qr) const
 
 inline void ysd_phy_2d::QuadTree::CreateChild(TreeNode* root, uint8_t qr, const Bound & bound)
 {
-	(root->children)[qr] = new TreeNode;
+	{
+		std::lock_guard<std::mutex> lock(node_mutex_);
+		(root->children)[qr] = node_pool_.Allocate();
+	}
+	(root->children)[qr]->parent = root;
 	(root->children)[qr]->bound = bound;
+	(root->children)[qr]->loose_bound = LooseBound(bound);
+	(root->children)[qr]->deep = root->deep + 1;
 }
 
-void QuadTree::Remove(uint16_t id, const Bound& bound)
+void QuadTree::Remove(ColliderHandle handle)
 {
-	this->RemoveNode(id, bound, root_.get());
+	if (handle >= locations_.size() || !locations_[handle].inserted)
+		return;
+
+	TreeNode* node = locations_[handle].node;
+	if (node != nullptr)
+	{
+		RemoveFromNode(handle);
+		Collapse(node);
+	}
+	locations_[handle].inserted = false;
 }
 
-// The tree may need update when a node move.
-bool ysd_phy_2d::QuadTree::MoveNode(const std::shared_ptr<BaseCollider> collider, const Vector2 & movement, TreeNode* root)
+void QuadTree::Refit(ColliderHandle handle)
 {
-	if (root == nullptr)
-		return false;
+	if (handle >= locations_.size() || !locations_[handle].inserted)
+		return;
+
+	TreeNode* node = locations_[handle].node;
+	const Bound& bound = pool_->bound(handle);
+
+	// The collider may up to the node's father node. The root keeps the
+	// colliders out of the world.
+	if (node != root_ && !BoundinBound(node->loose_bound, bound))
+	{
+		// Reinsert the collider from the root.
+		RemoveFromNode(handle);
+		InsertNode(handle, root_);
+		Collapse(node);
+		return;
+	}
+
+	MoveDown(handle, node);
+}
+
+void QuadTree::MoveDown(ColliderHandle handle, TreeNode* node)
+{
+	if (node->deep >= max_deep_)
+		return;
+
+	const Bound& bound = pool_->bound(handle);
+	const Bound& node_bound = node->bound;
+
+	// In a loose tree, the collider stays until it leaves the loose bound
+	// or becomes small enough for a child.
+	if (loose())
+	{
+		if (LooseQuadrant(node, bound) >= 0)
+		{
+			RemoveFromNode(handle);
+			InsertNode(handle, node, node->deep);
+		}
+		return;
+	}
 
-	// Find the collider in this tree node.
-	std::vector<std::shared_ptr<BaseCollider>>& colliders = root->colliders;
-	for (std::size_t i, length = colliders.size(); i < length; ++i)
+	// The collider may down to one of the node's children.
+	Vector2 center = (node_bound.max + node_bound.min) / 2;
+	if (!VertivalAxisCrossBound(bound, center.x()) &&
+		!HorizentalAxisCrossBound(bound, center.y()))
 	{
-		if (colliders[i] == collider)
+		// The collider was already leave the node's bound's axis.
+		RemoveFromNode(handle);
+		if (!InsertNodeInChildren(handle, node, node->deep))
 		{
-			// Move the collider and reset its bound.
-			collider->Translate(movement);
-			// The collider may no longer belong to this quad.
-			if (!BoundinBound(root->bound, collider->bound))
+			AddToNode(handle, node);
+		}
+	}
+}
+
+bool ysd_phy_2d::QuadTree::InsertNodeInChildren(ColliderHandle handle, TreeNode* root, uint8_t deep)
+{
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		TreeNode* const* const children = root->children;
+		//auto children = root->children;
+		if (children[i] != nullptr)
+		{
+			if (BoundinBound(children[i]->bound, pool_->bound(handle)))
 			{
-				// Remove it and insert it again.
-				colliders.erase(colliders.cbegin() + i);
-				this->InsertNode(collider, root_.get());
+				// The collider is in child's bound.
+				InsertNode(handle, children[i], deep + 1);
+				return true;
+			}
+			else
+			{
+				// The collider is out of the bound.
+				continue;
+			}
+		}
+		else
+		{
+			Bound bound = this->CreateBound(root, i);
+			if (BoundinBound(bound, pool_->bound(handle)))
+			{
+				// The collider is in the bound.
+				// The child is null, create it first.
+				CreateChild(root, i, bound);
+				InsertNode(handle, children[i], deep + 1);
+				return true;
+			}
+			else
+			{
+				// The collider is out of the bound.
+				continue;
 			}
-			return true;
 		}
 	}
+	return false;
+}
 
-	// Find the collider in one of the four children.
-	for (std::size_t i = 0; i < 4; i++)
+void QuadTree::AddToNode(ColliderHandle handle, TreeNode* node)
+{
+	Location& location = locations_[handle];
+	location.node = node;
+	location.slot = static_cast<uint32_t>(node->colliders.size());
+	node->colliders.push_back(handle);
+}
+
+void QuadTree::RemoveFromNode(ColliderHandle handle)
+{
+	Location& location = locations_[handle];
+	auto& colliders = location.node->colliders;
+
+	// Swap with the last one and pop.
+	ColliderHandle last = colliders.back();
+	colliders[location.slot] = last;
+	locations_[last].slot = location.slot;
+	colliders.pop_back();
+
+	location.node = nullptr;
+}
+
+void QuadTree::Collapse(TreeNode* node, uint8_t min_deep)
+{
+	// The root is never freed.
+	while (node != root_ && node->deep >= min_deep && node->colliders.empty() && node->IsLeaf())
 	{
-		TreeNode* child = root->children[i];
-		if (child != nullptr)
+		TreeNode* parent = node->parent;
+		for (uint8_t i = 0; i < 4; i++)
 		{
-			const Bound& big_bound = root->children[i]->bound;
-			if (BoundinBound(big_bound, collider->bound))
+			if (parent->children[i] == node)
 			{
-				// It is here!! Find it in this child.
-				return this->MoveNode(collider, movement, child);
+				parent->children[i] = nullptr;
+				break;
 			}
 		}
+		{
+			std::lock_guard<std::mutex> lock(node_mutex_);
+			node_pool_.Free(node);
+		}
+		node = parent;
 	}
+}
 
-	// The node with the given id is not found.
-	return false;
+void QuadTree::FreeSubtree(TreeNode* root)
+{
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		if (root->children[i] != nullptr)
+		{
+			FreeSubtree(root->children[i]);
+		}
+	}
+	node_pool_.Free(root);
 }
 
-// @param[in]	deep	In which deep we find the rotated collider.
-bool ysd_phy_2d::QuadTree::ScaleNode(const std::shared_ptr<BaseCollider> collider, const Vector2& scale, TreeNode * root, uint8_t deep = 0)
+void QuadTree::CollectTasks(TreeNode* root)
 {
+	if (root->deep == task_deep_)
+	{
+		task_roots_.push_back(root);
+		return;
+	}
+
+	top_nodes_.push_back(root);
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		if (root->children[i] != nullptr)
+		{
+			CollectTasks(root->children[i]);
+		}
+	}
+}
+
+uint32_t QuadTree::TaskKey(const TreeNode* task_root) const
+{
+	uint32_t key = 0;
+	for (const TreeNode* node = task_root; node != root_; node = node->parent)
+	{
+		uint32_t qr = 0;
+		while (node->parent->children[qr] != node)
+		{
+			++qr;
+		}
+		key = key * 4 + qr;
+	}
+	return key;
+}
+
+void QuadTree::RefitBatch(const ColliderHandle* handles, std::size_t count)
+{
+	if (threads_ == nullptr)
+	{
+		BroadPhase::RefitBatch(handles, count);
+		return;
+	}
 
-	if (root == nullptr)
-		return false;
+	// Sort the colliders into the subtrees at the task deep. Only the
+	// subtrees with colliders become tasks.
+	subtree_refits_.clear();
+	top_refits_.clear();
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		ColliderHandle handle = handles[i];
+		if (handle >= locations_.size() || !locations_[handle].inserted)
+			continue;
 
-	// Find the colldier in this root.
-	std::vector<std::shared_ptr<BaseCollider>>& colliders = root->colliders;
-	for (std::size_t i, length = colliders.size(); i < length; ++i)
+		TreeNode* node = locations_[handle].node;
+		if (node->deep < task_deep_)
+		{
+			top_refits_.push_back(handle);
+			continue;
+		}
+
+		while (node->deep > task_deep_)
+		{
+			node = node->parent;
+		}
+		subtree_refits_.push_back(SubtreeRefit{ TaskKey(node), handle, node });
+	}
+	std::sort(subtree_refits_.begin(), subtree_refits_.end(), [](const SubtreeRefit& a, const SubtreeRefit& b) {
+		return a.key != b.key ? a.key < b.key : a.handle < b.handle;
+	});
+
+	refit_task_count_ = 0;
+	for (std::size_t begin = 0, end = 0; begin < subtree_refits_.size(); begin = end)
 	{
-		if (colliders[i] == collider)
+		while (end < subtree_refits_.size() && subtree_refits_[end].key == subtree_refits_[begin].key)
+		{
+			++end;
+		}
+		if (refit_task_count_ == refit_tasks_.size())
 		{
-			// Scale the collider
-			collider->ScaleFor(scale);
+			refit_tasks_.emplace_back();
+		}
+		RefitTask& task = refit_tasks_[refit_task_count_++];
+		task.root = subtree_refits_[begin].root;
+		task.begin = begin;
+		task.end = end;
+	}
 
-			const Bound& root_bound = root->bound;
-			// If the collider became smaller, it may go down to the root's child nodes.
-			Vector2 center = (root_bound.max + root_bound.min) / 2;
-			if (deep < max_deep_ &&
-				!VertivalAxisCrossBound(collider->bound, center.x()) &&
-				!HorizentalAxisCrossBound(collider->bound, center.y()))
+	// A subtree only changes its own nodes. The colliders leaving it are
+	// taken out and put back from the root later.
+	auto refit = [this](uint32_t index, uint32_t) {
+		RefitTask& task = refit_tasks_[index];
+		task.leaving.clear();
+		for (std::size_t i = task.begin; i < task.end; ++i)
+		{
+			ColliderHandle handle = subtree_refits_[i].handle;
+			TreeNode* node = locations_[handle].node;
+			const Bound& bound = pool_->bound(handle);
+			if (BoundinBound(node->loose_bound, bound))
 			{
-				// The collider was already leave the root's bound's axis.
-				// It may go down into one of the four children of the root.
-				colliders.erase(colliders.cbegin() + i);
+				MoveDown(handle, node);
+				continue;
+			}
 
-				// Insert the removed collider to one of the four children.
-				return InsertNodeInChildren(collider, root, deep);
+			RemoveFromNode(handle);
+			if (BoundinBound(task.root->loose_bound, bound))
+			{
+				InsertNode(handle, task.root, task.root->deep);
+			}
+			else
+			{
+				task.leaving.push_back(handle);
 			}
+			Collapse(node, task_deep_ + 1);
+		}
+	};
+	threads_->ParallelFor(static_cast<uint32_t>(refit_task_count_), refit);
+
+	// Merge: the colliders above the subtrees, then the ones that left
+	// their subtree, then the subtrees that became empty.
+	for (ColliderHandle handle : top_refits_)
+	{
+		Refit(handle);
+	}
+	for (std::size_t i = 0; i < refit_task_count_; ++i)
+	{
+		for (ColliderHandle handle : refit_tasks_[i].leaving)
+		{
+			InsertNode(handle, root_);
+		}
+	}
+	for (std::size_t i = 0; i < refit_task_count_; ++i)
+	{
+		Collapse(refit_tasks_[i].root);
+	}
+}
 
-			// If the collider became bigger, it may go up to the root's parent node.
-			if (!BoundinBound(root_bound, collider->bound))
+void QuadTree::QueryPairs(PairBuffer& pairs)
+{
+	pairs.Clear();
+	if (threads_ == nullptr)
+	{
+		QueryPairsInNode(root_, pairs);
+		return;
+	}
+
+	top_nodes_.clear();
+	task_roots_.clear();
+	CollectTasks(root_);
+
+	// Task 0 is the nodes above the task deep, they are checked against
+	// the whole tree below them. The others are the subtrees.
+	const std::size_t task_count = task_roots_.size() + 1;
+	while (task_pairs_.size() < task_count)
+	{
+		task_pairs_.emplace_back(new PairBuffer(PairBuffer::kDefaultCapacity / 16));
+	}
+
+	auto query = [this](uint32_t task, uint32_t) {
+		PairBuffer& task_pairs = *task_pairs_[task];
+		task_pairs.Clear();
+		if (task == 0)
+		{
+			for (const TreeNode* node : top_nodes_)
 			{
-				// Reinsert the collider.
-				colliders.erase(colliders.cbegin() + i);
-				return InsertNode(collider, root_.get());
+				QueryPairsAtNode(node, task_pairs);
 			}
 		}
+		else
+		{
+			QueryPairsInNode(task_roots_[task - 1], task_pairs);
+		}
+	};
+	threads_->ParallelFor(static_cast<uint32_t>(task_count), query);
+
+	for (std::size_t i = 0; i < task_count; ++i)
+	{
+		pairs.Append(*task_pairs_[i]);
 	}
+}
 
+void QuadTree::QueryPairsInNode(const TreeNode* root, PairBuffer& pairs) const
+{
+	QueryPairsAtNode(root, pairs);
 
-	// Find the collider in one of the four children.
-	for (std::size_t i = 0; i < 4; i++)
+	for (std::size_t c = 0; c < 4; ++c)
 	{
-		TreeNode* child = root->children[i];
+		const TreeNode* child = root->children[c];
 		if (child != nullptr)
 		{
-			const Bound& big_bound = root->children[i]->bound;
-			if (BoundinBound(big_bound, collider->bound))
+			QueryPairsInNode(child, pairs);
+		}
+	}
+}
+
+void QuadTree::QueryPairsAtNode(const TreeNode* root, PairBuffer& pairs) const
+{
+	const Bound* bounds = pool_->bounds();
+	const auto& colliders = root->colliders;
+	const std::size_t length = colliders.size();
+
+	for (std::size_t i = 0; i < length; ++i)
+	{
+		ColliderHandle handle = colliders[i];
+		const Bound& bound = bounds[handle];
+
+		// Pairs in this node.
+		for (std::size_t j = i + 1; j < length; ++j)
+		{
+			if (BoundContactBound(bound, bounds[colliders[j]]))
 			{
-				// It is here!! Find it in this child.
-				return this->ScaleNode(collider, scale, child, deep + 1);
+				pairs.Push(handle, colliders[j]);
+			}
+		}
+
+		// Pairs between this node and its descendants.
+		for (std::size_t c = 0; c < 4; ++c)
+		{
+			const TreeNode* child = root->children[c];
+			if (child != nullptr)
+			{
+				QueryPairsWithSubtree(handle, child, pairs);
 			}
 		}
 	}
 
-	return false;
+	// The children's loose bounds overlap each other, there may be pairs
+	// between two children.
+	if (loose())
+	{
+		for (std::size_t c1 = 0; c1 < 4; ++c1)
+		{
+			for (std::size_t c2 = c1 + 1; c2 < 4; ++c2)
+			{
+				if (root->children[c1] != nullptr && root->children[c2] != nullptr)
+				{
+					QueryPairsBetweenSubtrees(root->children[c1], root->children[c2], pairs);
+				}
+			}
+		}
+	}
+}
+
+std::size_t QuadTree::QueryRegion(const Bound& region, uint16_t* ids, std::size_t capacity) const
+{
+	std::size_t found = 0;
+	QueryRegionInNode(root_, region, ids, capacity, found);
+	return found;
+}
+
+void QuadTree::QueryRegionInNode(const TreeNode* root, const Bound& region, uint16_t* ids, std::size_t capacity, std::size_t& found) const
+{
+	const Bound* bounds = pool_->bounds();
+	for (ColliderHandle handle : root->colliders)
+	{
+		if (BoundContactBound(region, bounds[handle]))
+		{
+			if (found < capacity)
+				ids[found] = pool_->id(handle);
+			++found;
+		}
+	}
+
+	// The colliders out of the world are only in the root, all the others
+	// are inside the loose bound of their nodes.
+	for (std::size_t c = 0; c < 4; ++c)
+	{
+		const TreeNode* child = root->children[c];
+		if (child != nullptr && BoundContactBound(region, child->loose_bound))
+		{
+			QueryRegionInNode(child, region, ids, capacity, found);
+		}
+	}
 }
 
-// @param[in]	deep	In which deep we find the rotated collider.
-bool ysd_phy_2d::QuadTree::RotateNode(const std::shared_ptr<BaseCollider> collider, const float angle, TreeNode * root, uint8_t deep = 0)
+std::size_t QuadTree::QueryPoint(const Vector2& point, uint16_t* ids, std::size_t capacity) const
 {
+	std::size_t found = 0;
+	QueryPointInNode(root_, point, ids, capacity, found);
+	return found;
+}
 
-	if (root == nullptr)
-		return false;
+void QuadTree::QueryPointInNode(const TreeNode* root, const Vector2& point, uint16_t* ids, std::size_t capacity, std::size_t& found) const
+{
+	const Bound* bounds = pool_->bounds();
+	for (ColliderHandle handle : root->colliders)
+	{
+		if (PointInBound(bounds[handle], point))
+		{
+			if (found < capacity)
+				ids[found] = pool_->id(handle);
+			++found;
+		}
+	}
 
-	// Find the collider first in this tree node.
-	std::vector<std::shared_ptr<BaseCollider>>& colliders = root->colliders;
-	for (std::size_t i, length = colliders.size(); i < length; ++i)
+	for (std::size_t c = 0; c < 4; ++c)
 	{
-		if (colliders[i] == collider)
+		const TreeNode* child = root->children[c];
+		if (child != nullptr && PointInBound(child->loose_bound, point))
 		{
+			QueryPointInNode(child, point, ids, capacity, found);
+		}
+	}
+}
+
+std::size_t QuadTree::QueryRegions(const Bound* regions, std::size_t count, uint16_t* ids, std::size_t capacity, uint32_t* offsets)
+{
+	region_hits_.clear();
+	query_regions_.clear();
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		query_regions_.push_back(static_cast<uint32_t>(i));
+	}
+	if (count > 0)
+	{
+		QueryRegionsInNode(root_, regions, 0, count);
+	}
+
+	// Counting sort of the hits by region, a region's hits keep the order
+	// of the walk.
+	std::fill(offsets, offsets + count + 1, 0);
+	for (const RegionHit& hit : region_hits_)
+	{
+		++offsets[hit.region + 1];
+	}
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
 
-			// Rotate the collider and reset its bound.
-			collider->Rotate(angle);
+	const std::size_t found = region_hits_.size();
+	if (found > capacity)
+		return found;
 
-			const Bound& root_bound = root->bound;
-			// The collider may up to the root's father node.
-			if (!BoundinBound(root_bound, collider->bound))
+	for (const RegionHit& hit : region_hits_)
+	{
+		ids[offsets[hit.region]++] = pool_->id(hit.handle);
+	}
+
+	// The scatter moved every offset to the end of its region.
+	for (std::size_t i = count; i > 0; --i)
+	{
+		offsets[i] = offsets[i - 1];
+	}
+	offsets[0] = 0;
+	return found;
+}
+
+void QuadTree::QueryRegionsInNode(const TreeNode* root, const Bound* regions, std::size_t begin, std::size_t end)
+{
+	const Bound* bounds = pool_->bounds();
+	for (ColliderHandle handle : root->colliders)
+	{
+		const Bound& bound = bounds[handle];
+		for (std::size_t i = begin; i < end; ++i)
+		{
+			uint32_t region = query_regions_[i];
+			if (BoundContactBound(regions[region], bound))
 			{
-				// Reinsert the node.
-				colliders.erase(colliders.cbegin() + i);
-				return InsertNode(collider, root_.get());
+				region_hits_.push_back(RegionHit{ region, handle });
 			}
+		}
+	}
 
-			// The collider may down to this colliders' one child.
-			Vector2 center = (root_bound.max + root_bound.min) / 2;
-			if (deep < max_deep_ &&
-				!VertivalAxisCrossBound(collider->bound, center.x()) &&
-				!HorizentalAxisCrossBound(collider->bound, center.y()))
-			{
-				// The collider was already leave the root's bound's axis.
-				// It may go down into one of the four children of the root.
-				colliders.erase(colliders.cbegin() + i);
+	for (std::size_t c = 0; c < 4; ++c)
+	{
+		const TreeNode* child = root->children[c];
+		if (child == nullptr)
+			continue;
 
-				// Insert the removed collider to one of the four children.
-				return InsertNodeInChildren(collider, root, deep);
+		// The regions of the child go after the ones of its ancestors.
+		const std::size_t child_begin = query_regions_.size();
+		for (std::size_t i = begin; i < end; ++i)
+		{
+			uint32_t region = query_regions_[i];
+			if (BoundContactBound(regions[region], child->loose_bound))
+			{
+				query_regions_.push_back(region);
 			}
 		}
+
+		const std::size_t child_end = query_regions_.size();
+		if (child_end > child_begin)
+		{
+			QueryRegionsInNode(child, regions, child_begin, child_end);
+		}
+		query_regions_.resize(child_begin);
 	}
+}
+
+bool QuadTree::Raycast(const Ray& ray, RaycastHit* hit) const
+{
+	float best = ray.max_fraction;
+	return RaycastInNode(root_, ray, InverseDirection(ray), hit, best);
+}
+
+bool QuadTree::RaycastInNode(const TreeNode* root, const Ray& ray, const Vector2& inv_direction, RaycastHit* hit, float& best) const
+{
+	bool found = false;
+	const Bound* bounds = pool_->bounds();
+	for (ColliderHandle handle : root->colliders)
+	{
+		float enter;
+		if (!RaycastBound(bounds[handle], ray, inv_direction, best, &enter))
+			continue;
 
+		Ray clipped = ray;
+		clipped.max_fraction = best;
+		RaycastHit candidate;
+		if (ysd_phy_2d::Raycast(*pool_->collider(handle), clipped, &candidate) && candidate.fraction < best)
+		{
+			*hit = candidate;
+			best = candidate.fraction;
+			found = true;
+		}
+	}
 
-	// Find the collider in one of the four children.
-	for (std::size_t i = 0; i < 4; i++)
+	// Sort the children the ray enters by where it enters them.
+	const TreeNode* children[4];
+	float enters[4];
+	int count = 0;
+	for (std::size_t c = 0; c < 4; ++c)
 	{
-		TreeNode* child = root->children[i];
-		if (child != nullptr)
+		const TreeNode* child = root->children[c];
+		float enter;
+		if (child == nullptr || !RaycastBound(child->loose_bound, ray, inv_direction, best, &enter))
+			continue;
+
+		int i = count++;
+		for (; i > 0 && enters[i - 1] > enter; --i)
 		{
-			const Bound& big_bound = root->children[i]->bound;
-			if (BoundinBound(big_bound, collider->bound))
-			{
-				// It is here!! Find it in this child.
-				return this->RotateNode(collider, angle, child, deep + 1);
-			}
+			children[i] = children[i - 1];
+			enters[i] = enters[i - 1];
 		}
+		children[i] = child;
+		enters[i] = enter;
 	}
 
-	return false;
+	for (int i = 0; i < count; ++i)
+	{
+		// The others are entered even later.
+		if (enters[i] >= best)
+			break;
+		found |= RaycastInNode(children[i], ray, inv_direction, hit, best);
+	}
+	return found;
+}
+
+std::size_t QuadTree::RaycastBatch(const Ray* rays, std::size_t count, RaycastHit* hits, uint64_t* hit_bits)
+{
+	const Bound& root_bound = root_->bound;
+	const float scale_x = 65536 / (root_bound.max.x() - root_bound.min.x());
+	const float scale_y = 65536 / (root_bound.max.y() - root_bound.min.y());
+
+	ray_order_.clear();
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const Ray& ray = rays[i];
+		uint64_t quadrant = (ray.direction.x() >= 0 ? 0 : 1) | (ray.direction.y() >= 0 ? 0 : 2);
+		uint32_t morton = SpreadBits(Quantize(ray.origin.x(), root_bound.min.x(), scale_x, 65536)) |
+			(SpreadBits(Quantize(ray.origin.y(), root_bound.min.y(), scale_y, 65536)) << 1);
+		ray_order_.emplace_back((quadrant << 32) | morton, static_cast<uint32_t>(i));
+	}
+	std::sort(ray_order_.begin(), ray_order_.end());
 
+	std::fill(hit_bits, hit_bits + (count + 63) / 64, 0);
+	std::size_t hit_count = 0;
+	for (const std::pair<uint64_t, uint32_t>& entry : ray_order_)
+	{
+		uint32_t i = entry.second;
+		if (Raycast(rays[i], &hits[i]))
+		{
+			hit_bits[i >> 6] |= uint64_t(1) << (i & 63);
+			++hit_count;
+		}
+	}
+	return hit_count;
 }
 
-bool ysd_phy_2d::QuadTree::InsertNodeInChildren(const std::shared_ptr<ysd_phy_2d::BaseCollider> collider, TreeNode* root, uint8_t deep)
+std::size_t QuadTree::QueryNearest(const Vector2& point, std::size_t k, uint16_t* ids, float* distances)
 {
-	for (uint8_t i = 0; i < 4; i++)
+	typedef std::pair<float, const TreeNode*> NodeEntry;
+	auto farther = [](const NodeEntry& e1, const NodeEntry& e2) { return e1.first > e2.first; };
+
+	nearest_.clear();
+	nearest_nodes_.clear();
+	if (k == 0)
+		return 0;
+
+	// The colliders out of the world are in the root, it is visited first
+	// whatever its bound.
+	nearest_nodes_.push_back(NodeEntry(0.0f, root_));
+
+	const Bound* bounds = pool_->bounds();
+	while (!nearest_nodes_.empty())
 	{
-		TreeNode* const* const children = root->children;
-		//auto children = root->children;
-		if (children[i] != nullptr)
+		std::pop_heap(nearest_nodes_.begin(), nearest_nodes_.end(), farther);
+		NodeEntry entry = nearest_nodes_.back();
+		nearest_nodes_.pop_back();
+
+		// The squared distance of the kth collider, the colliders and the
+		// nodes farther than it can not be in the result.
+		float worst = nearest_.size() < k ? std::numeric_limits<float>::max() :
+			nearest_.front().first * nearest_.front().first;
+		if (entry.first > worst)
+			break;
+
+		const TreeNode* node = entry.second;
+		for (ColliderHandle handle : node->colliders)
 		{
-			if (BoundinBound(children[i]->bound, collider->bound()))
+			if (SqrDistance(bounds[handle], point) > worst)
+				continue;
+
+			std::pair<float, uint16_t> candidate(Distance(*pool_->collider(handle), point), pool_->id(handle));
+			if (nearest_.size() < k)
 			{
-				// The collider is in child's bound.
-				InsertNode(collider, children[i], deep + 1);
-				return true;
+				nearest_.push_back(candidate);
+				std::push_heap(nearest_.begin(), nearest_.end());
+			}
+			else if (candidate < nearest_.front())
+			{
+				std::pop_heap(nearest_.begin(), nearest_.end());
+				nearest_.back() = candidate;
+				std::push_heap(nearest_.begin(), nearest_.end());
 			}
 			else
 			{
-				// The collider is out of the bound.
 				continue;
 			}
-		}
-		else
-		{
-			Bound bound = this->CreateBound(root, i);
-			if (BoundinBound(bound, collider->bound()))
+
+			if (nearest_.size() == k)
 			{
-				// The collider is in the bound.
-				// The child is null, create it first.
-				CreateChild(root, i, bound);
-				InsertNode(collider, children[i], deep + 1);
-				return true;
+				worst = nearest_.front().first * nearest_.front().first;
 			}
-			else
-			{
-				// The collider is out of the bound.
+		}
+
+		for (std::size_t c = 0; c < 4; ++c)
+		{
+			const TreeNode* child = node->children[c];
+			if (child == nullptr)
 				continue;
+
+			float distance = SqrDistance(child->loose_bound, point);
+			if (distance <= worst)
+			{
+				nearest_nodes_.push_back(NodeEntry(distance, child));
+				std::push_heap(nearest_nodes_.begin(), nearest_nodes_.end(), farther);
 			}
 		}
 	}
-	return false;
+
+	std::sort_heap(nearest_.begin(), nearest_.end());
+	for (std::size_t i = 0, l = nearest_.size(); i < l; ++i)
+	{
+		ids[i] = nearest_[i].second;
+		if (distances != nullptr)
+			distances[i] = nearest_[i].first;
+	}
+	return nearest_.size();
 }
 
-// Find the node recursively with given id and remove id.
-// Note that this function must not delete root.
-bool QuadTree::RemoveNode(uint16_t id, const Bound& bound, TreeNode* root)
+std::size_t QuadTree::QueryRadius(const Vector2& point, float radius, uint16_t* ids, std::size_t capacity) const
 {
-	if (root == nullptr)
-		return false;
+	std::size_t found = 0;
+	QueryRadiusInNode(root_, point, radius, ids, capacity, found);
+	return found;
+}
 
-	// Find the collider in this tree node.
-	std::vector<std::shared_ptr<BaseCollider>>& colliders = root->colliders;
-	for (std::size_t i = 0, l = colliders.size(); i < l; i++)
+void QuadTree::QueryRadiusInNode(const TreeNode* root, const Vector2& point, float radius, uint16_t* ids, std::size_t capacity, std::size_t& found) const
+{
+	const float sqr_radius = radius * radius;
+	const Bound* bounds = pool_->bounds();
+	for (ColliderHandle handle : root->colliders)
 	{
-		if (colliders[i]->id() == id)
+		if (SqrDistance(bounds[handle], point) > sqr_radius)
+			continue;
+
+		if (Distance(*pool_->collider(handle), point) <= radius)
 		{
-			// We found it! Delete and remove it.
-			colliders[i].reset();
-			colliders.erase(colliders.cbegin() + i);
-			return true;
+			if (found < capacity)
+				ids[found] = pool_->id(handle);
+			++found;
+		}
+	}
+
+	for (std::size_t c = 0; c < 4; ++c)
+	{
+		const TreeNode* child = root->children[c];
+		if (child != nullptr && SqrDistance(child->loose_bound, point) <= sqr_radius)
+		{
+			QueryRadiusInNode(child, point, radius, ids, capacity, found);
+		}
+	}
+}
+
+void QuadTree::QueryPairsWithSubtree(ColliderHandle handle, const TreeNode* root, PairBuffer& pairs) const
+{
+	const Bound* bounds = pool_->bounds();
+	const Bound& bound = bounds[handle];
+
+	// All colliders in the subtree are inside its loose bound.
+	if (!BoundContactBound(bound, root->loose_bound))
+		return;
+
+	for (ColliderHandle other : root->colliders)
+	{
+		if (BoundContactBound(bound, bounds[other]))
+		{
+			pairs.Push(handle, other);
 		}
 	}
 
-	// Find the collider in one of the four children.
-	for (std::size_t i = 0; i < 4; i++)
+	for (std::size_t c = 0; c < 4; ++c)
 	{
-		TreeNode* child = root->children[i];
+		const TreeNode* child = root->children[c];
 		if (child != nullptr)
 		{
-			const Bound& big_bound = root->children[i]->bound;
-			if (BoundinBound(big_bound, bound))
+			QueryPairsWithSubtree(handle, child, pairs);
+		}
+	}
+}
+
+
+void QuadTree::QueryPairsBetweenSubtrees(const TreeNode* root1, const TreeNode* root2, PairBuffer& pairs) const
+{
+	if (!BoundContactBound(root1->loose_bound, root2->loose_bound))
+		return;
+
+	// Colliders of root1 against the whole subtree of root2.
+	for (ColliderHandle handle : root1->colliders)
+	{
+		QueryPairsWithSubtree(handle, root2, pairs);
+	}
+
+	// Colliders of root2 against the descendants of root1.
+	for (ColliderHandle handle : root2->colliders)
+	{
+		for (std::size_t c = 0; c < 4; ++c)
+		{
+			const TreeNode* child = root1->children[c];
+			if (child != nullptr)
 			{
-				// It is here!! Find it in this child.
-				return this->RemoveNode(id, bound, child);
+				QueryPairsWithSubtree(handle, child, pairs);
 			}
 		}
 	}
 
-	// The node with the given id is not found.
-	return false;
+	// Descendants of both.
+	for (std::size_t c1 = 0; c1 < 4; ++c1)
+	{
+		const TreeNode* child1 = root1->children[c1];
+		if (child1 == nullptr)
+			continue;
+
+		for (std::size_t c2 = 0; c2 < 4; ++c2)
+		{
+			const TreeNode* child2 = root2->children[c2];
+			if (child2 != nullptr)
+			{
+				QueryPairsBetweenSubtrees(child1, child2, pairs);
+			}
+		}
+	}
 }
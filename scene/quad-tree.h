@@ -9,11 +9,20 @@
 
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <assert.h>
 
 #include "../math/vector_2.h"
 #include "../math/bound.h"
 #include "../colliders/collider.h"
+#include "../colliders/raycast.h"
+#include "../colliders/distance.h"
 #include "../common/un-copy-move-interface.h"
+#include "../common/object-pool.h"
+#include "../common/inline-vector.h"
+#include "collider-pool.h"
+#include "collider-pair.h"
+#include "broad-phase.h"
 
 namespace ysd_phy_2d
 {
@@ -26,57 +35,188 @@ namespace ysd_phy_2d
 // --------------
 //   2   |   3
 /////////////////////////////////////////////////////////
-class QuadTree final : public IUncopyable
+class QuadTree final : public BroadPhase
 {
 public:
 
+	// Most nodes hold only a few colliders, they are kept inside the node.
+	static const std::size_t kInlineColliders = 8;
+
+	// The 16 subtrees two levels below the root are the parallel tasks.
+	static const uint8_t kDefaultTaskDeep = 2;
+
 	// Node structure in the quad tree.
-	struct TreeNode : public IUnCopyMovable
+	// A node starts at a cache line and takes two. The nodes are allocated
+	// from a pool.
+	struct alignas(64) TreeNode : public IUnCopyMovable
 	{
 		// Rectangle bound.
 		Bound bound;
 
+		// Bound enlarged by the looseness of the tree. All colliders of
+		// the subtree are inside it. Same as bound in a strict tree.
+		Bound loose_bound;
+
 		// The tree's 4 children.
-		TreeNode* children[4];
+		TreeNode* children[4] = { nullptr, nullptr, nullptr, nullptr };
 
-		// Colliders in this node.
-		std::vector<std::shared_ptr<BaseCollider>> colliders;
+		TreeNode* parent = nullptr;
 
+		// Handles of the colliders in this node.
+		InlineVector<ColliderHandle, kInlineColliders> colliders;
+
+		// Deep of the node. The root is zero.
+		uint8_t deep = 0;
+
+		bool IsLeaf() const
+		{
+			return children[0] == nullptr && children[1] == nullptr &&
+				children[2] == nullptr && children[3] == nullptr;
+		}
 	};
 
-	QuadTree(float width, float length, const Vector2& center, uint8_t deep = 8)
-		:root_(new TreeNode), max_deep_(deep)
+	// @param[in]	pool		Storage of the colliders. The tree only keeps handles.
+	// @param[in]	looseness	Child bounds are enlarged by this factor. A loose
+	//							tree (looseness > 1) let a collider go down to the
+	//							depth its size warrants instead of stopping at the
+	//							first axis it crosses, and the collider stay in its
+	//							node through small moves.
+	QuadTree(ColliderPool* pool, float width, float length, const Vector2& center, uint8_t deep = 8, float looseness = 1)
+		:BroadPhase(pool), root_(node_pool_.Allocate()), max_deep_(deep), looseness_(looseness)
 	{
+		assert(looseness >= 1);
 		Vector2 max(width / 2, length / 2);
 		root_->bound.max = max + center;
 		root_->bound.min = center - max;
+		root_->loose_bound = root_->bound;
 	}
 
 	// The defalut center is zeor.
-	QuadTree(float width, float length, uint8_t deep = 8)
-		:root_(new TreeNode), max_deep_(deep)
+	QuadTree(ColliderPool* pool, float width, float length, uint8_t deep = 8, float looseness = 1)
+		:BroadPhase(pool), root_(node_pool_.Allocate()), max_deep_(deep), looseness_(looseness)
 	{
+		assert(looseness >= 1);
 		Vector2 max(width / 2, length / 2);
 		root_->bound.max = max;
 		root_->bound.min = -max;
+		root_->loose_bound = root_->bound;
 	}
 
 	// Move construct
 	QuadTree(QuadTree&& other)
-		:max_deep_(other.max_deep_)
+		:BroadPhase(other.pool_), node_pool_(std::move(other.node_pool_)), root_(other.root_),
+		locations_(std::move(other.locations_)), max_deep_(other.max_deep_), looseness_(other.looseness_),
+		task_deep_(other.task_deep_)
 	{
-		root_.reset(other.root_.release());
+		threads_ = other.threads_;
+		other.root_ = nullptr;
+	}
+
+	~QuadTree()
+	{
+		if (root_ != nullptr)
+		{
+			FreeSubtree(root_);
+		}
 	}
 
 	// Insert a new collider in the tree.
-	// @param[in] 	id  		The collider's id.
-	// @param[in] 	collider 	The collider need to insert in.
-	void Insert(const std::shared_ptr<BaseCollider> collider);
+	// @param[in] 	handle 	Handle of the collider in the pool.
+	void Insert(ColliderHandle handle) override;
+
+	// Insert a batch of colliders. The target node of every collider is
+	// computed from the Morton code of its cell, the batch is sorted by
+	// the codes and put in the tree in one pass, where every collider
+	// reuses the path of the previous one instead of going down from the
+	// root.
+	// @param[in]	handles	Handles of the colliders in the pool.
+	void InsertBatch(const ColliderHandle* handles, std::size_t count) override;
+
+	// Remove a collider from the tree. The collider is still in the pool.
+	// @param[in] 	handle 	Handle of the collider in the pool.
+	void Remove(ColliderHandle handle) override;
+
+	// Put the collider in the right node after its bound changed.
+	// The node of the collider is found in constant time, the collider is
+	// only reinserted when it leaves its node or can go down into a child.
+	void Refit(ColliderHandle handle) override;
 
-	// Remove a collider from the tree with the given id and its AABB bound.
-	// @param[in]	id		The collider's id.
-	// @param[in]	bound	The collider's AABB bound.
-	void Remove(uint16_t id, const Bound& bound);
+	// Refit many colliders. With a thread pool, the subtrees at the task
+	// deep are refitted in parallel, every subtree by one task. The
+	// colliders above the subtrees and the ones leaving their subtree are
+	// put in place afterwards by the calling thread.
+	void RefitBatch(const ColliderHandle* handles, std::size_t count) override;
+
+	// Broad phase. Find all pairs of colliders whose bounds contact.
+	// A collider in a node can only contact the colliders in the same
+	// node or in the node's descendants, so every node is checked
+	// against itself and its subtrees. In a loose tree, the overlapping
+	// sibling subtrees are also checked against each other.
+	// With a thread pool, the subtrees at the task deep are searched in
+	// parallel and the nodes above them in one more task. The pairs of
+	// the tasks are joined in a fixed order.
+	// @param[out]	pairs	Cleared and filled with the candidate pairs.
+	void QueryPairs(PairBuffer& pairs) override;
+
+	// Find the colliders whose bounds contact a region. Only the subtrees
+	// whose loose bounds contact the region are visited.
+	// @param[out]	ids		Ids of the colliders, at most capacity.
+	// @return	Number of the colliders found, more than capacity if the
+	//			buffer is too small.
+	std::size_t QueryRegion(const Bound& region, uint16_t* ids, std::size_t capacity) const;
+
+	// Find the colliders whose bounds contain a point.
+	// @param[out]	ids		Ids of the colliders, at most capacity.
+	// @return	Number of the colliders found.
+	std::size_t QueryPoint(const Vector2& point, uint16_t* ids, std::size_t capacity) const;
+
+	// Answer many region queries in one walk of the tree. Every node is
+	// visited once with the regions that contact it, so the regions share
+	// the visits of the nodes they have in common.
+	// @param[out]	ids		Ids of the colliders of all regions, the ones of
+	//						the ith region are in [offsets[i], offsets[i + 1]).
+	//						Only written if all of them fit in capacity.
+	// @param[out]	offsets	count + 1 offsets, always written.
+	// @return	Number of the colliders found for all regions.
+	std::size_t QueryRegions(const Bound* regions, std::size_t count, uint16_t* ids, std::size_t capacity, uint32_t* offsets);
+
+	// Find the closest collider a ray hits, by the exact shape. The
+	// children are visited front to back, a subtree entered after the
+	// closest hit so far is skipped.
+	// A polygon hit by the ray caches its world data on the first use
+	// after it moved, so the queries are only safe from many threads at
+	// the same time once every polygon is cached, see
+	// PolygonCollider::UpdateCaches. Otherwise query a WorldSnapshot.
+	// @param[out]	hit		Only written if the ray hits.
+	bool Raycast(const Ray& ray, RaycastHit* hit) const;
+
+	// Cast many rays. They are traced sorted by the quadrant of their
+	// direction and the Morton code of their origin, so the rays from the
+	// same place in the same direction walk the same nodes one after
+	// another.
+	// @param[out]	hits		The closest hit of every ray, only written
+	//							for the rays that hit.
+	// @param[out]	hit_bits	Bit i of hit_bits[i / 64] is set if the ith
+	//							ray hits. At least (count + 63) / 64 words.
+	// @return	Number of the rays that hit.
+	std::size_t RaycastBatch(const Ray* rays, std::size_t count, RaycastHit* hits, uint64_t* hit_bits);
+
+	// Find the k colliders nearest to a point, by the exact distance to
+	// their shapes. The nodes are visited best first, nearest loose
+	// bound first, and the walk stops when the next node is farther than
+	// the kth collider found so far.
+	// @param[out]	ids			Ids of the colliders, nearest first.
+	// @param[out]	distances	Their distances, may be null.
+	// @return	Number of the colliders found, at most k.
+	std::size_t QueryNearest(const Vector2& point, std::size_t k, uint16_t* ids, float* distances);
+
+	// Find the colliders whose shapes are within a radius of a point.
+	// Like Raycast, only safe from many threads at the same time once the
+	// world data of every polygon is cached.
+	// @param[out]	ids		Ids of the colliders, at most capacity.
+	// @return	Number of the colliders found, more than capacity if the
+	//			buffer is too small.
+	std::size_t QueryRadius(const Vector2& point, float radius, uint16_t* ids, std::size_t capacity) const;
 
 	void set_max_deep(uint8_t value)
 	{
@@ -88,24 +228,98 @@ public:
 		return max_deep_;
 	}
 
-private:
-	bool InsertNode(const std::shared_ptr<BaseCollider> collider, TreeNode* root, uint8_t deep = 0);
+	float looseness() const
+	{
+		return looseness_;
+	}
 
-	// If remove the node successful, return true.
-	bool RemoveNode(uint16_t id, const Bound& bound, TreeNode* root);
+	// Number of nodes in the tree.
+	std::size_t node_count() const
+	{
+		return node_pool_.size();
+	}
+
+	bool loose() const
+	{
+		return looseness_ > 1;
+	}
+
+	// Deep of the subtrees that are the parallel tasks. There are at most
+	// 4 ^ deep tasks.
+	void set_task_deep(uint8_t value)
+	{
+		assert(value >= 1 && value <= 8);
+		task_deep_ = value;
+	}
+
+	uint8_t task_deep() const
+	{
+		return task_deep_;
+	}
 
-	// A collider move for a movement.
-	bool MoveNode(const std::shared_ptr<BaseCollider> collider, const Vector2 & movement, TreeNode* root);
+private:
+	bool InsertNode(ColliderHandle handle, TreeNode* root, uint8_t deep = 0);
 
-	// A collider scale.
-	bool ScaleNode(const std::shared_ptr<BaseCollider> collider, const Vector2& scale, TreeNode* root, uint8_t deep = 0);
+	// Push the collider into a node and record where it is.
+	void AddToNode(ColliderHandle handle, TreeNode* node);
 
-	// A polygon collider rotate.
-	// @param[in]	deep	In how deep we find the rotated collider.
-	bool RotateNode(const std::shared_ptr<BaseCollider> collider, const float angle, TreeNode* root, uint8_t deep = 0);
+	// Swap the collider with the last one in its node and pop it.
+	void RemoveFromNode(ColliderHandle handle);
 
 	// Insert new collider in one of the four children.
-	bool InsertNodeInChildren(const std::shared_ptr<ysd_phy_2d::BaseCollider> collider, TreeNode* root, uint8_t deep);
+	bool InsertNodeInChildren(ColliderHandle handle, TreeNode* root, uint8_t deep);
+
+	// @return	The quadrant whose loose bound contains the bound's center and the
+	//			whole bound, or -1 if the bound is too big for the children.
+	int8_t LooseQuadrant(const TreeNode* root, const Bound& bound) const;
+
+	// Enlarge a bound around its center by the looseness.
+	Bound LooseBound(const Bound& bound) const
+	{
+		Vector2 center = (bound.max + bound.min) / 2;
+		Vector2 half = (bound.max - bound.min) * (looseness_ / 2);
+		return Bound{ center - half, center + half };
+	}
+
+	// Collect the pairs in this node, then between this node and its
+	// descendants, then go down into the children.
+	void QueryPairsInNode(const TreeNode* root, PairBuffer& pairs) const;
+
+	// Collect the pairs of QueryPairsInNode without going down into the
+	// children.
+	void QueryPairsAtNode(const TreeNode* root, PairBuffer& pairs) const;
+
+	void QueryRegionInNode(const TreeNode* root, const Bound& region, uint16_t* ids, std::size_t capacity, std::size_t& found) const;
+
+	void QueryPointInNode(const TreeNode* root, const Vector2& point, uint16_t* ids, std::size_t capacity, std::size_t& found) const;
+
+	// @param[in,out]	best	Fraction of the closest hit so far.
+	// @return	True if a closer hit is found in the subtree.
+	bool RaycastInNode(const TreeNode* root, const Ray& ray, const Vector2& inv_direction, RaycastHit* hit, float& best) const;
+
+	void QueryRadiusInNode(const TreeNode* root, const Vector2& point, float radius, uint16_t* ids, std::size_t capacity, std::size_t& found) const;
+
+	// Collect the hits of the regions in query_regions_[begin, end) in a
+	// subtree whose loose bound they all contact.
+	void QueryRegionsInNode(const TreeNode* root, const Bound* regions, std::size_t begin, std::size_t end);
+
+	// The collider is still inside its node. Move it into a child if it
+	// fits there.
+	void MoveDown(ColliderHandle handle, TreeNode* node);
+
+	// Gather the roots of the subtrees at the task deep, and the nodes
+	// above them, in depth first order.
+	void CollectTasks(TreeNode* root);
+
+	// Identify a subtree at the task deep by the quadrants on its path.
+	uint32_t TaskKey(const TreeNode* task_root) const;
+
+	// Collect the pairs between a collider and all colliders in a subtree.
+	void QueryPairsWithSubtree(ColliderHandle handle, const TreeNode* root, PairBuffer& pairs) const;
+
+	// Collect the pairs between two subtrees whose loose bounds overlap.
+	// Only needed in a loose tree.
+	void QueryPairsBetweenSubtrees(const TreeNode* root1, const TreeNode* root2, PairBuffer& pairs) const;
 
 	// Create bound for four quadrants.
 	// @param[in]	qr 	[0, 3].
@@ -114,12 +328,126 @@ private:
 	// Create 1/4 rect in root's bound.
 	inline void CreateChild(TreeNode* root, uint8_t qr, const Bound& bound);
 
-	std::unique_ptr<TreeNode> root_;
+	// A collider of a batch and the node it goes to.
+	struct BatchEntry
+	{
+		// Morton code of the node's cell at the deepest batch level, the
+		// bits below the node's deep are zero.
+		uint32_t key;
+		uint8_t deep;
+		ColliderHandle handle;
+	};
+
+	// The batch insertion does not go deeper than this, 16 levels fill
+	// the 32 bits of a Morton code.
+	static const uint8_t kMaxBatchDeep = 16;
+
+	// Find the target node of a collider in the batch insertion.
+	// @param[in]	deep	Deepest level of the batch.
+	BatchEntry BatchTarget(ColliderHandle handle, uint8_t deep) const;
+
+	// Give the empty leaves back to the pool, from the node up to the root.
+	// @param[in]	min_deep	Nodes above this deep are kept.
+	void Collapse(TreeNode* node, uint8_t min_deep = 1);
+
+	// Give all nodes of a subtree back to the pool.
+	void FreeSubtree(TreeNode* root);
+
+	ObjectPool<TreeNode> node_pool_;
+
+	TreeNode* root_;
+
+	// Reused by the batch insertion.
+	std::vector<BatchEntry> batch_;
+
+	// Where a collider is in the tree.
+	struct Location
+	{
+		TreeNode* node;
+		uint32_t slot;
+
+		// The collider was inserted and not removed yet.
+		bool inserted;
+	};
+
+	// Indexed by collider handle. The node is null if the collider is
+	// not in the tree. The colliders out of the world are in the root.
+	std::vector<Location> locations_;
 
 	// Start from zero.
 	uint8_t max_deep_;
 
+	// Factor of the children's loose bounds. 1 for a strict tree.
+	float looseness_;
+
+	// Guards node_pool_, the parallel tasks create and free nodes.
+	std::mutex node_mutex_;
+
+	uint8_t task_deep_ = kDefaultTaskDeep;
+
+	// Nodes above the task deep and the roots of the subtrees at it.
+	std::vector<const TreeNode*> top_nodes_;
+	std::vector<TreeNode*> task_roots_;
+
+	// Pairs of every task of QueryPairs, the top nodes' are the first.
+	std::vector<std::unique_ptr<PairBuffer>> task_pairs_;
+
+	// A collider of RefitBatch below the task deep, with the subtree it
+	// is in.
+	struct SubtreeRefit
+	{
+		uint32_t key;
+		ColliderHandle handle;
+		TreeNode* root;
+	};
+
+	// Sorted by TaskKey, a run of the same key is a task.
+	std::vector<SubtreeRefit> subtree_refits_;
+
+	// The colliders of a subtree in RefitBatch, a run of subtree_refits_.
+	struct RefitTask
+	{
+		TreeNode* root;
+		std::size_t begin;
+		std::size_t end;
+
+		// Colliders that left the subtree, taken out of the tree.
+		std::vector<ColliderHandle> leaving;
+	};
+
+	// Only the first refit_task_count_ are used. Kept to reuse the
+	// leaving lists.
+	std::vector<RefitTask> refit_tasks_;
+	std::size_t refit_task_count_ = 0;
+
+	// Colliders above the task deep, including the ones out of the world.
+	std::vector<ColliderHandle> top_refits_;
+
+	// A collider found by a region of QueryRegions.
+	struct RegionHit
+	{
+		uint32_t region;
+		ColliderHandle handle;
+	};
+
+	// Reused by QueryRegions. The regions that contact the nodes on the
+	// path from the root, a node's regions are pushed after its parent's.
+	std::vector<uint32_t> query_regions_;
+	std::vector<RegionHit> region_hits_;
+
+	// Sort key and index of every ray of RaycastBatch.
+	std::vector<std::pair<uint64_t, uint32_t>> ray_order_;
+
+	// Reused by QueryNearest. A min heap of the nodes to visit by their
+	// squared distances, and a max heap of the k best colliders by their
+	// distances and ids.
+	std::vector<std::pair<float, const TreeNode*>> nearest_nodes_;
+	std::vector<std::pair<float, uint16_t>> nearest_;
+
 };
+
+static_assert(sizeof(QuadTree::TreeNode) <= 128, "A tree node should fit in two cache lines.");
+
 }
 
 #endif
\ No newline at end of file
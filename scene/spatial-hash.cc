@@ -0,0 +1,165 @@
+#include "spatial-hash.h"
+
+using namespace ysd_phy_2d;
+
+const uint32_t SpatialHash::kNotInserted;
+
+void SpatialHash::Insert(ColliderHandle handle)
+{
+	if (handle >= handle_slots_.size())
+	{
+		handle_slots_.resize(handle + 1, kNotInserted);
+	}
+	assert(handle_slots_[handle] == kNotInserted);
+
+	handle_slots_[handle] = static_cast<uint32_t>(handles_.size());
+	handles_.push_back(handle);
+}
+
+void SpatialHash::Remove(ColliderHandle handle)
+{
+	if (handle >= handle_slots_.size() || handle_slots_[handle] == kNotInserted)
+		return;
+
+	// Swap with the last one and pop.
+	uint32_t slot = handle_slots_[handle];
+	ColliderHandle last = handles_.back();
+	handles_[slot] = last;
+	handle_slots_[last] = slot;
+	handles_.pop_back();
+	handle_slots_[handle] = kNotInserted;
+}
+
+void SpatialHash::ReserveTable(std::size_t cell_count)
+{
+	std::size_t size = table_.size();
+	if (size >= cell_count * 2)
+		return;
+
+	if (size == 0)
+		size = 64;
+	while (size < cell_count * 2)
+		size *= 2;
+
+	table_.resize(size);
+	stamps_.assign(size, 0);
+	frame_ = 0;
+}
+
+uint32_t SpatialHash::FindOrAddCell(int32_t x, int32_t y)
+{
+	uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+	uint32_t mask = static_cast<uint32_t>(table_.size() - 1);
+
+	// Fibonacci hashing, then linear probing.
+	uint32_t slot = static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+	for (;;)
+	{
+		Cell& cell = table_[slot];
+		if (stamps_[slot] != frame_)
+		{
+			// An empty slot. The cell is new in this frame.
+			stamps_[slot] = frame_;
+			cell.x = x;
+			cell.y = y;
+			cell.count = 0;
+			used_slots_.push_back(slot);
+			return slot;
+		}
+
+		if (cell.x == x && cell.y == y)
+			return slot;
+
+		slot = (slot + 1) & mask;
+	}
+}
+
+void SpatialHash::Build()
+{
+	const Bound* bounds = pool_->bounds();
+
+	// Every cell a collider covers is an entry. There are not more cells
+	// than entries.
+	std::size_t entry_count = 0;
+	for (ColliderHandle handle : handles_)
+	{
+		const Bound& bound = bounds[handle];
+		std::size_t w = CellCoord(bound.max.x()) - CellCoord(bound.min.x()) + 1;
+		std::size_t h = CellCoord(bound.max.y()) - CellCoord(bound.min.y()) + 1;
+		entry_count += w * h;
+	}
+	ReserveTable(entry_count);
+	++frame_;
+
+	// Count the colliders of every cell.
+	used_slots_.clear();
+	entry_slots_.clear();
+	entry_handles_.clear();
+	for (ColliderHandle handle : handles_)
+	{
+		const Bound& bound = bounds[handle];
+		int32_t x0 = CellCoord(bound.min.x()), x1 = CellCoord(bound.max.x());
+		int32_t y0 = CellCoord(bound.min.y()), y1 = CellCoord(bound.max.y());
+		for (int32_t y = y0; y <= y1; ++y)
+		{
+			for (int32_t x = x0; x <= x1; ++x)
+			{
+				uint32_t slot = FindOrAddCell(x, y);
+				table_[slot].count++;
+				entry_slots_.push_back(slot);
+				entry_handles_.push_back(handle);
+			}
+		}
+	}
+
+	// Prefix sum, every cell gets its span.
+	uint32_t start = 0;
+	for (uint32_t slot : used_slots_)
+	{
+		Cell& cell = table_[slot];
+		cell.start = start;
+		start += cell.count;
+		cell.count = 0;
+	}
+
+	// Scatter the handles into their spans.
+	entries_.resize(entry_handles_.size());
+	for (std::size_t i = 0, l = entry_handles_.size(); i < l; ++i)
+	{
+		Cell& cell = table_[entry_slots_[i]];
+		entries_[cell.start + cell.count++] = entry_handles_[i];
+	}
+}
+
+void SpatialHash::QueryPairs(PairBuffer& pairs)
+{
+	pairs.Clear();
+	Build();
+
+	const Bound* bounds = pool_->bounds();
+	for (uint32_t slot : used_slots_)
+	{
+		const Cell& cell = table_[slot];
+		const ColliderHandle* span = entries_.data() + cell.start;
+
+		for (uint32_t i = 0; i < cell.count; ++i)
+		{
+			const Bound& bound = bounds[span[i]];
+			for (uint32_t j = i + 1; j < cell.count; ++j)
+			{
+				const Bound& other = bounds[span[j]];
+				if (!BoundContactBound(bound, other))
+					continue;
+
+				// Two colliders may share more than one cell. Only the cell
+				// that holds the min corner of their overlap reports them.
+				float x = std::max(bound.min.x(), other.min.x());
+				float y = std::max(bound.min.y(), other.min.y());
+				if (CellCoord(x) == cell.x && CellCoord(y) == cell.y)
+				{
+					pairs.Push(span[i], span[j]);
+				}
+			}
+		}
+	}
+}
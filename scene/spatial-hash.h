@@ -0,0 +1,116 @@
+//////////////////////////////////////////////////////////
+// @fileoverview Uniform grid broad phase with a hashed
+//				 cell table.
+// @author	ysd
+//////////////////////////////////////////////////////////
+
+#ifndef _SPATIAL_HASH_H_
+#define _SPATIAL_HASH_H_
+
+#include <vector>
+#include <cmath>
+#include <assert.h>
+
+#include "../math/bound.h"
+#include "broad-phase.h"
+
+namespace ysd_phy_2d
+{
+
+/////////////////////////////////////////////////////////
+// A SpatialHash put the colliders in the cells of an
+// unbounded uniform grid.
+//
+// The grid is rebuilt every frame: the cells a collider
+// covers are looked up in an open addressing table, then
+// a counting sort lay the handles of every cell out in one
+// contiguous span. Only the colliders in the same span are
+// checked against each other.
+//
+// It fits a crowd of colliders of about the same size,
+// e.g. projectiles and units. The cell size should be a
+// bit bigger than the colliders, then a collider covers
+// at most four cells. A collider much bigger than a cell
+// is put in every cell it covers.
+/////////////////////////////////////////////////////////
+class SpatialHash final : public BroadPhase
+{
+public:
+	// @param[in]	cell_size	Width and height of a cell.
+	SpatialHash(ColliderPool* pool, float cell_size)
+		: BroadPhase(pool), cell_size_(cell_size), inv_cell_size_(1 / cell_size)
+	{}
+
+	void Insert(ColliderHandle handle) override;
+
+	void Remove(ColliderHandle handle) override;
+
+	// The grid is rebuilt from the pool before the query.
+	void Refit(ColliderHandle) override {}
+
+	void QueryPairs(PairBuffer& pairs) override;
+
+	float cell_size() const { return cell_size_; }
+
+private:
+	// Slot of a handle that is not in the grid.
+	static const uint32_t kNotInserted = 0xffffffff;
+
+	struct Cell
+	{
+		// Coordinates of the cell in the grid.
+		int32_t x;
+		int32_t y;
+
+		// Span of the cell's handles in entries_.
+		uint32_t start;
+		uint32_t count;
+	};
+
+	int32_t CellCoord(float v) const
+	{
+		return static_cast<int32_t>(std::floor(v * inv_cell_size_));
+	}
+
+	// Find the slot of a cell in the table, take an empty slot if the
+	// cell is not there.
+	uint32_t FindOrAddCell(int32_t x, int32_t y);
+
+	// Make the table at least twice as big as the number of cells.
+	void ReserveTable(std::size_t cell_count);
+
+	// Fill the cells with the handles of the colliders.
+	void Build();
+
+	float cell_size_;
+	float inv_cell_size_;
+
+	// Handles of the colliders in the grid.
+	std::vector<ColliderHandle> handles_;
+
+	// Index of the collider in handles_, indexed by handle. kNotInserted
+	// if it is not in the grid.
+	std::vector<uint32_t> handle_slots_;
+
+	// Open addressing table of the cells. The size is a power of two.
+	std::vector<Cell> table_;
+
+	// A slot is used in this frame if its stamp is the frame. The table
+	// does not need to be cleared between frames.
+	std::vector<uint32_t> stamps_;
+	uint32_t frame_ = 0;
+
+	// Slots in the table that are used this frame.
+	std::vector<uint32_t> used_slots_;
+
+	// Table slot of every (cell, collider) entry before sorting.
+	std::vector<uint32_t> entry_slots_;
+	std::vector<ColliderHandle> entry_handles_;
+
+	// Handles sorted by cell.
+	std::vector<ColliderHandle> entries_;
+};
+
+}
+
+#endif
@@ -0,0 +1,139 @@
+#include "sweep-and-prune.h"
+
+#include <algorithm>
+
+using namespace ysd_phy_2d;
+
+void SweepAndPrune::Insert(ColliderHandle handle)
+{
+	if (handle >= inserted_.size())
+	{
+		inserted_.resize(handle + 1, 0);
+		removals_.resize(handle + 1, PendingRemoval{ 0, 0 });
+		active_slots_.resize(handle + 1);
+	}
+	if (inserted_[handle])
+		return;
+	inserted_[handle] = 1;
+
+	const Bound& bound = pool_->bound(handle);
+
+	// Append at the end. The next sort move them to their place.
+	endpoints_.push_back(Endpoint{ AxisValue(bound.min), handle, false });
+	endpoints_.push_back(Endpoint{ AxisValue(bound.max), handle, true });
+}
+
+void SweepAndPrune::Remove(ColliderHandle handle)
+{
+	if (handle >= inserted_.size() || !inserted_[handle])
+		return;
+	inserted_[handle] = 0;
+
+	// The endpoints stay until the next sweep drops them.
+	++removals_[handle].mins;
+	++removals_[handle].maxes;
+	++removal_count_;
+}
+
+void SweepAndPrune::CompactEndpoints()
+{
+	if (removal_count_ == 0)
+		return;
+
+	// Both the sorted and the new part keep their order.
+	std::size_t kept = 0, sorted_kept = 0;
+	for (std::size_t i = 0, l = endpoints_.size(); i < l; ++i)
+	{
+		const Endpoint& e = endpoints_[i];
+		PendingRemoval& removal = removals_[e.handle];
+		uint8_t& count = e.is_max ? removal.maxes : removal.mins;
+		if (count > 0)
+		{
+			--count;
+			continue;
+		}
+
+		endpoints_[kept++] = e;
+		if (i < sorted_size_)
+			++sorted_kept;
+	}
+	endpoints_.resize(kept);
+	sorted_size_ = sorted_kept;
+	removal_count_ = 0;
+}
+
+void SweepAndPrune::UpdateEndpoints()
+{
+	const Bound* bounds = pool_->bounds();
+	for (Endpoint& e : endpoints_)
+	{
+		const Bound& bound = bounds[e.handle];
+		e.value = AxisValue(e.is_max ? bound.max : bound.min);
+	}
+}
+
+void SweepAndPrune::SortEndpoints()
+{
+	for (std::size_t i = 1; i < sorted_size_; ++i)
+	{
+		if (!Less(endpoints_[i], endpoints_[i - 1]))
+			continue;
+
+		Endpoint e = endpoints_[i];
+		std::size_t j = i;
+		do
+		{
+			endpoints_[j] = endpoints_[j - 1];
+			--j;
+		} while (j > 0 && Less(e, endpoints_[j - 1]));
+		endpoints_[j] = e;
+	}
+
+	// New endpoints.
+	if (sorted_size_ < endpoints_.size())
+	{
+		auto middle = endpoints_.begin() + sorted_size_;
+		std::sort(middle, endpoints_.end(), Less);
+		std::inplace_merge(endpoints_.begin(), middle, endpoints_.end(), Less);
+		sorted_size_ = endpoints_.size();
+	}
+}
+
+void SweepAndPrune::QueryPairs(PairBuffer& pairs)
+{
+	pairs.Clear();
+
+	CompactEndpoints();
+	UpdateEndpoints();
+	SortEndpoints();
+
+	const Bound* bounds = pool_->bounds();
+	active_.clear();
+
+	for (const Endpoint& e : endpoints_)
+	{
+		if (e.is_max)
+		{
+			// Close the interval. Swap with the last one and pop.
+			uint32_t slot = active_slots_[e.handle];
+			ColliderHandle last = active_.back();
+			active_[slot] = last;
+			active_slots_[last] = slot;
+			active_.pop_back();
+			continue;
+		}
+
+		// The intervals overlap on the axis, check the bounds.
+		const Bound& bound = bounds[e.handle];
+		for (ColliderHandle other : active_)
+		{
+			if (BoundContactBound(bound, bounds[other]))
+			{
+				pairs.Push(other, e.handle);
+			}
+		}
+
+		active_slots_[e.handle] = static_cast<uint32_t>(active_.size());
+		active_.push_back(e.handle);
+	}
+}
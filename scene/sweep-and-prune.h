@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////
+// @fileoverview Sort and sweep broad phase.
+// @author	ysd
+//////////////////////////////////////////////////////////
+
+#ifndef _SWEEP_AND_PRUNE_H_
+#define _SWEEP_AND_PRUNE_H_
+
+#include <vector>
+
+#include "../math/bound.h"
+#include "broad-phase.h"
+
+namespace ysd_phy_2d
+{
+
+/////////////////////////////////////////////////////////
+// Sweep and prune along the major axis of the world.
+//
+// Every collider has a min and a max endpoint on the
+// axis. The endpoints are kept sorted between frames,
+// colliders move a little every frame so an insertion
+// sort on the nearly sorted array is close to linear.
+//
+// The sweep walks the endpoints in order and keep the
+// colliders whose interval is open. A collider is only
+// tested against the open ones when its interval begins.
+//
+// It does not depend on the size of the world, which
+// makes it a good fit for long corridors that the quad
+// tree subdivides poorly.
+/////////////////////////////////////////////////////////
+class SweepAndPrune final : public BroadPhase
+{
+public:
+	// @param[in]	axis	0 to sweep along x, 1 to sweep along y.
+	SweepAndPrune(ColliderPool* pool, uint8_t axis = 0)
+		: BroadPhase(pool), axis_(axis)
+	{}
+
+	void Insert(ColliderHandle handle) override;
+
+	void Remove(ColliderHandle handle) override;
+
+	// The endpoints are refreshed from the pool before the sweep.
+	void Refit(ColliderHandle) override {}
+
+	void QueryPairs(PairBuffer& pairs) override;
+
+	uint8_t axis() const { return axis_; }
+
+private:
+	struct Endpoint
+	{
+		float value;
+		ColliderHandle handle;
+		// True for the max end of the interval.
+		bool is_max;
+	};
+
+	// Drop the endpoints of the colliders removed since the last sweep,
+	// in one pass for all of them.
+	void CompactEndpoints();
+
+	// Read the value of every endpoint from the bounds in the pool.
+	void UpdateEndpoints();
+
+	// Insertion sort on the endpoints sorted in the last frame. Nearly
+	// linear when the order barely changed. The endpoints inserted since
+	// then are sorted on their own and merged.
+	void SortEndpoints();
+
+	// Ordered by (value, is_max, handle), a strict weak ordering even for
+	// colliders of zero width. At the same value the min endpoints come
+	// first, so touching intervals are both open and the bounds decide.
+	static bool Less(const Endpoint& e1, const Endpoint& e2)
+	{
+		if (e1.value != e2.value)
+			return e1.value < e2.value;
+		if (e1.is_max != e2.is_max)
+			return e2.is_max;
+		return e1.handle < e2.handle;
+	}
+
+	float AxisValue(const Vector2& vec) const
+	{
+		return axis_ == 0 ? vec.x() : vec.y();
+	}
+
+	uint8_t axis_;
+
+	// Sorted endpoints, two per collider.
+	std::vector<Endpoint> endpoints_;
+
+	// Number of endpoints at the front of endpoints_ that were sorted
+	// in the last frame.
+	std::size_t sorted_size_ = 0;
+
+	// Colliders whose interval is open during the sweep.
+	std::vector<ColliderHandle> active_;
+
+	// Index of the collider in active_, indexed by handle.
+	std::vector<uint32_t> active_slots_;
+
+	// Indexed by handle, the collider is inserted and not removed.
+	std::vector<uint8_t> inserted_;
+
+	// Indexed by handle, the endpoints of removed colliders that are not
+	// dropped yet. A handle may be removed and inserted again before the
+	// sweep, then any two of its endpoints can go since they read the
+	// same bound.
+	struct PendingRemoval
+	{
+		uint8_t mins;
+		uint8_t maxes;
+	};
+	std::vector<PendingRemoval> removals_;
+	std::size_t removal_count_ = 0;
+};
+
+}
+
+#endif
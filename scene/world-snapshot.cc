@@ -0,0 +1,302 @@
+#include "world-snapshot.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace ysd_phy_2d;
+
+const std::size_t WorldSnapshot::kLeafSize;
+const uint32_t WorldSnapshot::kNotFound;
+const uint32_t SnapshotBuffer::kMaxReaders;
+
+namespace
+{
+
+// Put a zero bit before every bit of a 16 bits value.
+inline uint32_t SpreadBits(uint32_t v)
+{
+	v &= 0x0000ffff;
+	v = (v | (v << 8)) & 0x00ff00ff;
+	v = (v | (v << 4)) & 0x0f0f0f0f;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+// Cell of a coordinate in a grid of 65536 cells.
+inline uint32_t Quantize(float v, float min, float scale)
+{
+	float q = (v - min) * scale;
+	if (q <= 0)
+		return 0;
+	if (q >= 65535)
+		return 65535;
+	return static_cast<uint32_t>(q);
+}
+
+}
+
+void WorldSnapshot::Build(const ColliderPool& pool, uint64_t frame)
+{
+	frame_ = frame;
+
+	// The extent of all centers, the Morton codes are taken in it.
+	float min_x = std::numeric_limits<float>::max(), min_y = min_x;
+	float max_x = -min_x, max_y = -min_x;
+	for (std::size_t h = 0, l = pool.capacity(); h < l; ++h)
+	{
+		if (pool.collider(static_cast<ColliderHandle>(h)) == nullptr)
+			continue;
+
+		const Bound& bound = pool.bound(static_cast<ColliderHandle>(h));
+		Vector2 center = (bound.min + bound.max) / 2;
+		min_x = std::min(min_x, center.x());
+		min_y = std::min(min_y, center.y());
+		max_x = std::max(max_x, center.x());
+		max_y = std::max(max_y, center.y());
+	}
+	float scale_x = max_x > min_x ? 65535 / (max_x - min_x) : 0;
+	float scale_y = max_y > min_y ? 65535 / (max_y - min_y) : 0;
+
+	order_.clear();
+	uint16_t max_id = 0;
+	for (std::size_t h = 0, l = pool.capacity(); h < l; ++h)
+	{
+		ColliderHandle handle = static_cast<ColliderHandle>(h);
+		if (pool.collider(handle) == nullptr)
+			continue;
+
+		const Bound& bound = pool.bound(handle);
+		Vector2 center = (bound.min + bound.max) / 2;
+		uint32_t key = SpreadBits(Quantize(center.x(), min_x, scale_x)) |
+			(SpreadBits(Quantize(center.y(), min_y, scale_y)) << 1);
+		order_.emplace_back(key, handle);
+		max_id = std::max(max_id, pool.id(handle));
+	}
+	std::sort(order_.begin(), order_.end());
+
+	const std::size_t count = order_.size();
+	ids_.resize(count);
+	bounds_.resize(count);
+	positions_.resize(count);
+	scales_.resize(count);
+	angles_.resize(count);
+	types_.resize(count);
+	radii_.resize(count);
+	vertex_offsets_.resize(count + 1);
+	vertex_xs_.clear();
+	vertex_ys_.clear();
+	edge_normals_.clear();
+	slots_.assign(count > 0 ? max_id + 1 : 0, kNotFound);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		ColliderHandle handle = order_[i].second;
+		ids_[i] = pool.id(handle);
+		bounds_[i] = pool.bound(handle);
+		positions_[i] = pool.position(handle);
+		scales_[i] = pool.scale(handle);
+		angles_[i] = pool.angle(handle);
+		types_[i] = pool.type(handle);
+		radii_[i] = pool.radius(handle);
+		slots_[ids_[i]] = static_cast<uint32_t>(i);
+
+		vertex_offsets_[i] = static_cast<uint32_t>(vertex_xs_.size());
+		if (types_[i] == kPolygonColliderType)
+		{
+			const PolygonCollider& polygon = static_cast<const PolygonCollider&>(*pool.collider(handle));
+			const float* xs = polygon.world_xs();
+			const float* ys = polygon.world_ys();
+			const std::vector<Vector2>& normals = polygon.world_normals();
+			vertex_xs_.insert(vertex_xs_.end(), xs, xs + normals.size());
+			vertex_ys_.insert(vertex_ys_.end(), ys, ys + normals.size());
+			edge_normals_.insert(edge_normals_.end(), normals.begin(), normals.end());
+		}
+	}
+	vertex_offsets_[count] = static_cast<uint32_t>(vertex_xs_.size());
+
+	nodes_.clear();
+	if (count > 0)
+	{
+		BuildNode(0, static_cast<uint32_t>(count));
+	}
+}
+
+void WorldSnapshot::BuildNode(uint32_t begin, uint32_t end)
+{
+	uint32_t index = static_cast<uint32_t>(nodes_.size());
+	nodes_.push_back(Node{ Bound(), begin, end, 0 });
+
+	Bound bound;
+	if (end - begin <= kLeafSize)
+	{
+		bound = bounds_[begin];
+		for (uint32_t i = begin + 1; i < end; ++i)
+		{
+			bound = MergeBound(bound, bounds_[i]);
+		}
+	}
+	else
+	{
+		// Half of the colliders on each side, they are close in space
+		// since they are sorted by their Morton codes.
+		uint32_t middle = begin + (end - begin) / 2;
+		uint32_t left = index + 1;
+		BuildNode(begin, middle);
+		uint32_t right = static_cast<uint32_t>(nodes_.size());
+		BuildNode(middle, end);
+		bound = MergeBound(nodes_[left].bound, nodes_[right].bound);
+	}
+
+	nodes_[index].bound = bound;
+	nodes_[index].next = static_cast<uint32_t>(nodes_.size());
+}
+
+std::size_t WorldSnapshot::QueryRegion(const Bound& region, uint16_t* ids, std::size_t capacity) const
+{
+	std::size_t found = 0;
+	uint32_t index = 0;
+	const uint32_t node_count = static_cast<uint32_t>(nodes_.size());
+	while (index < node_count)
+	{
+		const Node& node = nodes_[index];
+		if (!BoundContactBound(region, node.bound))
+		{
+			index = node.next;
+			continue;
+		}
+
+		if (!node.IsLeaf())
+		{
+			++index;
+			continue;
+		}
+
+		for (uint32_t i = node.begin; i < node.end; ++i)
+		{
+			if (BoundContactBound(region, bounds_[i]))
+			{
+				if (found < capacity)
+					ids[found] = ids_[i];
+				++found;
+			}
+		}
+		index = node.next;
+	}
+	return found;
+}
+
+bool WorldSnapshot::Raycast(const Ray& ray, RaycastHit* hit) const
+{
+	const Vector2 inv_direction = InverseDirection(ray);
+	float best = ray.max_fraction;
+	bool found = false;
+	uint32_t index = 0;
+	const uint32_t node_count = static_cast<uint32_t>(nodes_.size());
+	while (index < node_count)
+	{
+		const Node& node = nodes_[index];
+		float enter;
+		if (!RaycastBound(node.bound, ray, inv_direction, best, &enter))
+		{
+			index = node.next;
+			continue;
+		}
+
+		if (!node.IsLeaf())
+		{
+			++index;
+			continue;
+		}
+
+		for (uint32_t i = node.begin; i < node.end; ++i)
+		{
+			if (!RaycastBound(bounds_[i], ray, inv_direction, best, &enter))
+				continue;
+
+			// Clipped by the nearest hit so far, like QuadTree::Raycast.
+			Ray clipped = ray;
+			clipped.max_fraction = best;
+			RaycastHit candidate;
+			bool hit_collider = types_[i] == kCircleColliderType ?
+				RaycastCircle(ids_[i], positions_[i], radii_[i], clipped, &candidate) :
+				RaycastPolygon(ids_[i], vertex_xs(i), vertex_ys(i), edge_normals(i), vertex_count(i), clipped, &candidate);
+			if (hit_collider && candidate.fraction < best)
+			{
+				*hit = candidate;
+				best = candidate.fraction;
+				found = true;
+			}
+		}
+		index = node.next;
+	}
+	return found;
+}
+
+SnapshotBuffer::SnapshotBuffer()
+	: current_(nullptr), epoch_(1), reader_count_(0)
+{
+	for (ReaderSlot& slot : readers_)
+	{
+		slot.epoch.store(0, std::memory_order_relaxed);
+	}
+}
+
+void SnapshotBuffer::Publish(const ColliderPool& pool, uint64_t frame)
+{
+	Reclaim();
+
+	WorldSnapshot* snapshot;
+	if (free_.empty())
+	{
+		snapshots_.emplace_back(new WorldSnapshot());
+		snapshot = snapshots_.back().get();
+	}
+	else
+	{
+		snapshot = free_.back();
+		free_.pop_back();
+	}
+	snapshot->Build(pool, frame);
+
+	// The readers that load the pointer from now on get the new snapshot.
+	// The old one may still be read by those that started at this epoch
+	// or before.
+	WorldSnapshot* old = current_.exchange(snapshot);
+	if (old != nullptr)
+	{
+		retired_.push_back(Retired{ old, epoch_.fetch_add(1) });
+	}
+}
+
+const WorldSnapshot* SnapshotBuffer::Enter(uint32_t reader)
+{
+	// The announcement must be visible before the pointer is loaded, all
+	// accesses are sequentially consistent.
+	readers_[reader].epoch.store(epoch_.load());
+	return current_.load();
+}
+
+void SnapshotBuffer::Reclaim()
+{
+	if (retired_.empty())
+		return;
+
+	uint64_t oldest = std::numeric_limits<uint64_t>::max();
+	for (uint32_t i = 0, l = std::min(reader_count_.load(), kMaxReaders); i < l; ++i)
+	{
+		uint64_t epoch = readers_[i].epoch.load();
+		if (epoch != 0)
+			oldest = std::min(oldest, epoch);
+	}
+
+	// A reader that started after a snapshot was retired can not see it.
+	std::size_t kept = 0;
+	for (const Retired& retired : retired_)
+	{
+		if (retired.epoch < oldest)
+			free_.push_back(retired.snapshot);
+		else
+			retired_[kept++] = retired;
+	}
+	retired_.resize(kept);
+}
@@ -0,0 +1,249 @@
+//////////////////////////////////////////////////////////
+// @fileoverview Read-only copy of the world for the query
+//				 threads, and the double buffer that
+//				 publishes it.
+// @author	ysd
+//////////////////////////////////////////////////////////
+
+#ifndef _WORLD_SNAPSHOT_H_
+#define _WORLD_SNAPSHOT_H_
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <assert.h>
+
+#include "../math/vector_2.h"
+#include "../math/bound.h"
+#include "../colliders/collider.h"
+#include "../colliders/raycast.h"
+#include "../common/un-copy-move-interface.h"
+#include "collider-pool.h"
+
+namespace ysd_phy_2d
+{
+
+/////////////////////////////////////////////////////////
+// A WorldSnapshot is a copy of the colliders' transforms,
+// bounds and shapes in world space at the end of a frame,
+// with its own static index over the bounds.
+//
+// The colliders are sorted by the Morton code of their
+// centers, the index is a binary tree over ranges of the
+// sorted colliders, laid out in depth first order. Every
+// node knows where its subtree ends, so a query walks the
+// array without a stack.
+//
+// It is never changed after it is built, any number of
+// threads can query it.
+/////////////////////////////////////////////////////////
+class WorldSnapshot final : public IUncopyable
+{
+public:
+	// Colliders of a leaf of the index.
+	static const std::size_t kLeafSize = 8;
+
+	// Returned by Find for an id not in the snapshot.
+	static const uint32_t kNotFound = 0xffffffff;
+
+	WorldSnapshot() = default;
+
+	// Copy the live colliders of the pool and build the index over them.
+	void Build(const ColliderPool& pool, uint64_t frame);
+
+	// Find the colliders whose bounds contact a region.
+	// @param[out]	ids			Ids of the colliders, at most capacity.
+	// @return	Number of the colliders found, more than capacity if the
+	//			buffer is too small.
+	std::size_t QueryRegion(const Bound& region, uint16_t* ids, std::size_t capacity) const;
+
+	// Find the first collider a ray enters, with the same kernels and the
+	// same hit as QuadTree::Raycast.
+	// @param[out]	hit		Written only if a collider is hit.
+	bool Raycast(const Ray& ray, RaycastHit* hit) const;
+
+	// @return	Index of the collider with the id, or kNotFound.
+	uint32_t Find(uint16_t id) const
+	{
+		return id < slots_.size() ? slots_[id] : kNotFound;
+	}
+
+	// Frame of Update the snapshot was taken at.
+	uint64_t frame() const { return frame_; }
+
+	// Number of colliders.
+	std::size_t size() const { return ids_.size(); }
+
+	// The colliders are read by index, in [0, size).
+	uint16_t id(uint32_t i) const { return ids_[i]; }
+	const Bound& bound(uint32_t i) const { return bounds_[i]; }
+	const Vector2& position(uint32_t i) const { return positions_[i]; }
+	const Vector2& scale(uint32_t i) const { return scales_[i]; }
+	float angle(uint32_t i) const { return angles_[i]; }
+	ColliderType type(uint32_t i) const { return types_[i]; }
+	float radius(uint32_t i) const { return radii_[i]; }
+
+	// World vertices of a polygon, none for a circle.
+	std::size_t vertex_count(uint32_t i) const { return vertex_offsets_[i + 1] - vertex_offsets_[i]; }
+	const float* vertex_xs(uint32_t i) const { return vertex_xs_.data() + vertex_offsets_[i]; }
+	const float* vertex_ys(uint32_t i) const { return vertex_ys_.data() + vertex_offsets_[i]; }
+	const Vector2* edge_normals(uint32_t i) const { return edge_normals_.data() + vertex_offsets_[i]; }
+
+private:
+	struct Node
+	{
+		Bound bound;
+
+		// Range of the node's colliders.
+		uint32_t begin;
+		uint32_t end;
+
+		// Index of the first node after the subtree.
+		uint32_t next;
+
+		bool IsLeaf() const { return end - begin <= kLeafSize; }
+	};
+
+	// Build the subtree over the colliders in [begin, end).
+	void BuildNode(uint32_t begin, uint32_t end);
+
+	uint64_t frame_ = 0;
+
+	// Collider data in Morton order.
+	std::vector<uint16_t> ids_;
+	std::vector<Bound> bounds_;
+	std::vector<Vector2> positions_;
+	std::vector<Vector2> scales_;
+	std::vector<float> angles_;
+	std::vector<ColliderType> types_;
+	std::vector<float> radii_;
+
+	// World vertices and edge normals of the polygons, those of the ith
+	// collider are in [vertex_offsets_[i], vertex_offsets_[i + 1]).
+	std::vector<uint32_t> vertex_offsets_;
+	std::vector<float> vertex_xs_;
+	std::vector<float> vertex_ys_;
+	std::vector<Vector2> edge_normals_;
+
+	// Index of every collider, indexed by id.
+	std::vector<uint32_t> slots_;
+
+	// Nodes of the index in depth first order, the root is the first.
+	std::vector<Node> nodes_;
+
+	// Morton code and handle of every collider, reused by Build.
+	std::vector<std::pair<uint32_t, ColliderHandle>> order_;
+};
+
+/////////////////////////////////////////////////////////
+// A SnapshotBuffer publish the snapshots of the world
+// built by the updating thread to the reader threads.
+//
+// A new snapshot is built aside and swapped in by an
+// atomic pointer exchange. A reader announces the epoch
+// it started at before loading the pointer, and an old
+// snapshot is only rebuilt when no reader started before
+// it was retired. Readers never wait, and the writer never
+// waits for them: if a reader keeps an old snapshot for
+// long, one more snapshot is allocated. Usually there are
+// only two.
+//
+// Reader
+//   SnapshotBuffer::ReadGuard guard(buffer, reader);
+//   if (guard.snapshot() != nullptr)
+//       guard.snapshot()->QueryRegion(...);
+/////////////////////////////////////////////////////////
+class SnapshotBuffer final : public IUnCopyMovable
+{
+public:
+	static const uint32_t kMaxReaders = 64;
+
+	SnapshotBuffer();
+
+	// Build a snapshot of the pool and make it the current one. Only the
+	// thread that updates the world calls it.
+	void Publish(const ColliderPool& pool, uint64_t frame);
+
+	// Give a reader thread its slot. A thread keeps its slot and only
+	// reads one snapshot at a time.
+	// @return	The reader's slot, in [0, kMaxReaders).
+	uint32_t AddReader()
+	{
+		uint32_t reader = reader_count_.fetch_add(1);
+		assert(reader < kMaxReaders);
+		return reader;
+	}
+
+	// Keep the current snapshot alive during its lifetime.
+	class ReadGuard final : public IUnCopyMovable
+	{
+	public:
+		ReadGuard(SnapshotBuffer& buffer, uint32_t reader)
+			: buffer_(buffer), reader_(reader), snapshot_(buffer.Enter(reader))
+		{}
+
+		~ReadGuard()
+		{
+			buffer_.Leave(reader_);
+		}
+
+		// Null before the first snapshot is published.
+		const WorldSnapshot* snapshot() const { return snapshot_; }
+
+	private:
+		SnapshotBuffer& buffer_;
+		uint32_t reader_;
+		const WorldSnapshot* snapshot_;
+	};
+
+	// Number of snapshots allocated.
+	std::size_t snapshot_count() const { return snapshots_.size(); }
+
+private:
+	// Announce the reader and load the current snapshot.
+	const WorldSnapshot* Enter(uint32_t reader);
+
+	void Leave(uint32_t reader)
+	{
+		readers_[reader].epoch.store(0, std::memory_order_release);
+	}
+
+	// Move the retired snapshots no reader can see to the free list.
+	void Reclaim();
+
+	struct ReaderSlot
+	{
+		// Epoch the reader started at, 0 when it does not read.
+		std::atomic<uint64_t> epoch;
+
+		// Keep the slots in different cache lines.
+		char padding[64 - sizeof(std::atomic<uint64_t>)];
+	};
+
+	// A snapshot replaced by a newer one at an epoch.
+	struct Retired
+	{
+		WorldSnapshot* snapshot;
+		uint64_t epoch;
+	};
+
+	std::atomic<WorldSnapshot*> current_;
+
+	// Increased by every publication. Starts from 1.
+	std::atomic<uint64_t> epoch_;
+
+	std::atomic<uint32_t> reader_count_;
+	ReaderSlot readers_[kMaxReaders];
+
+	// Only touched by the writer.
+	std::vector<std::unique_ptr<WorldSnapshot>> snapshots_;
+	std::vector<WorldSnapshot*> free_;
+	std::vector<Retired> retired_;
+};
+
+}
+
+#endif
@@ -0,0 +1,172 @@
+//////////////////////////////////////////////////////
+// @fileoverview QueryPairs of every broad phase against
+//				 brute force, through inserts, moves and
+//				 removes. See test/run-tests.sh.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#include <memory>
+#include <vector>
+
+#include "test-util.h"
+#include "../common/thread-pool.h"
+#include "../scene/broad-phase.h"
+#include "../scene/quad-tree.h"
+#include "../scene/sweep-and-prune.h"
+#include "../scene/aabb-tree.h"
+#include "../scene/spatial-hash.h"
+
+using namespace ysd_phy_2d;
+using namespace ysd_phy_2d::test;
+
+namespace
+{
+
+const float kHalfSize = 200;
+const uint16_t kColliderCount = 3000;
+const int kFrameCount = 6;
+
+enum Backend
+{
+	kStrictQuadTree,
+	kLooseQuadTree,
+	kSweepAndPrune,
+	kAabbTree,
+	kSpatialHash,
+	kBackendCount
+};
+
+const char* const kBackendNames[] = { "strict quad tree", "loose quad tree", "sweep and prune", "aabb tree", "spatial hash" };
+
+std::unique_ptr<BroadPhase> CreateBroadPhase(Backend backend, ColliderPool* pool)
+{
+	switch (backend)
+	{
+	case kStrictQuadTree:
+		return std::unique_ptr<BroadPhase>(new QuadTree(pool, kHalfSize * 2, kHalfSize * 2));
+	case kLooseQuadTree:
+		return std::unique_ptr<BroadPhase>(new QuadTree(pool, kHalfSize * 2, kHalfSize * 2, 8, 2));
+	case kSweepAndPrune:
+		return std::unique_ptr<BroadPhase>(new SweepAndPrune(pool));
+	case kAabbTree:
+		return std::unique_ptr<BroadPhase>(new AabbTree(pool));
+	default:
+		return std::unique_ptr<BroadPhase>(new SpatialHash(pool, 8));
+	}
+}
+
+void CheckPairs(const char* name, int frame, ColliderPool& pool, BroadPhase& broad_phase, PairBuffer& pairs)
+{
+	broad_phase.QueryPairs(pairs);
+	auto found = SortedPairs(pool, pairs);
+	auto expected = BruteForcePairs(pool);
+	TEST_CHECK(found == expected, "%s frame %d: %zu pairs, %zu expected", name, frame, found.size(), expected.size());
+	TEST_CHECK(std::unique(found.begin(), found.end()) == found.end(), "%s frame %d: duplicated pairs", name, frame);
+}
+
+// Random colliders inserted one by one and in a batch, then moved,
+// removed and added frame by frame.
+void TestRandomScene(Backend backend, ThreadPool* threads, uint8_t task_deep = QuadTree::kDefaultTaskDeep)
+{
+	const char* name = kBackendNames[backend];
+	ColliderPool pool;
+	std::unique_ptr<BroadPhase> broad_phase = CreateBroadPhase(backend, &pool);
+	broad_phase->set_thread_pool(threads);
+	if (backend == kStrictQuadTree || backend == kLooseQuadTree)
+		static_cast<QuadTree&>(*broad_phase).set_task_deep(task_deep);
+	RandomScene scene(backend + 1, kHalfSize);
+	PairBuffer pairs;
+
+	std::vector<ColliderHandle> batch;
+	for (uint16_t id = 0; id < kColliderCount; ++id)
+	{
+		ColliderHandle handle = scene.Add(pool, id);
+		if (id < kColliderCount / 2)
+			broad_phase->Insert(handle);
+		else
+			batch.push_back(handle);
+	}
+	broad_phase->InsertBatch(batch.data(), batch.size());
+	CheckPairs(name, 0, pool, *broad_phase, pairs);
+
+	uint16_t next_id = kColliderCount;
+	for (int frame = 1; frame <= kFrameCount; ++frame)
+	{
+		// Everything moves, some colliders leave the world and come back.
+		std::vector<ColliderHandle> moved;
+		for (ColliderHandle handle = 0; handle < pool.capacity(); ++handle)
+		{
+			if (pool.collider(handle) == nullptr)
+				continue;
+			pool.Translate(handle, scene.Jitter(frame % 2 == 0 ? 2.0f : 40.0f));
+			moved.push_back(handle);
+		}
+		broad_phase->RefitBatch(moved.data(), moved.size());
+
+		// Replace a few colliders. A removed handle is removed twice, the
+		// second time must be ignored.
+		for (ColliderHandle handle = static_cast<ColliderHandle>(frame); handle < pool.capacity(); handle += 97)
+		{
+			if (pool.collider(handle) == nullptr)
+				continue;
+			broad_phase->Remove(handle);
+			broad_phase->Remove(handle);
+			pool.Remove(handle);
+		}
+		for (int i = 0; i < 20; ++i)
+		{
+			broad_phase->Insert(scene.Add(pool, next_id++));
+		}
+
+		CheckPairs(name, frame, pool, *broad_phase, pairs);
+	}
+}
+
+// Colliders that touch exactly at their edges, and colliders with no
+// width at all.
+void TestTouchingBounds(Backend backend)
+{
+	const char* name = kBackendNames[backend];
+	ColliderPool pool;
+	std::unique_ptr<BroadPhase> broad_phase = CreateBroadPhase(backend, &pool);
+	PairBuffer pairs;
+
+	uint16_t id = 0;
+	auto add_circle = [&](float x, float y, float radius) {
+		std::unique_ptr<BaseCollider> collider(new CircleCollider(id++, std::make_shared<Circle>(radius)));
+		collider->Translate(Vector2(x, y));
+		broad_phase->Insert(pool.Add(std::move(collider)));
+	};
+
+	// A row of circles touching each other, points on their edges and on
+	// each other.
+	for (int i = 0; i < 8; ++i)
+	{
+		add_circle(i * 2.0f, 0, 1);
+		add_circle(i * 2.0f + 1, 0, 0);
+		add_circle(i * 2.0f + 1, 1, 0);
+	}
+	add_circle(3, 0, 0);
+	add_circle(3, 0, 0);
+	CheckPairs(name, 0, pool, *broad_phase, pairs);
+}
+
+}
+
+int main()
+{
+	for (int backend = 0; backend < kBackendCount; ++backend)
+	{
+		TestRandomScene(static_cast<Backend>(backend), nullptr);
+		TestTouchingBounds(static_cast<Backend>(backend));
+	}
+
+	// The quad trees refit and search their subtrees in parallel.
+	ThreadPool threads(4);
+	TestRandomScene(kStrictQuadTree, &threads);
+	TestRandomScene(kLooseQuadTree, &threads);
+	TestRandomScene(kStrictQuadTree, &threads, 4);
+	TestRandomScene(kLooseQuadTree, &threads, 5);
+
+	return Finish("broad-phase-test");
+}
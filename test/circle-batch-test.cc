@@ -0,0 +1,109 @@
+//////////////////////////////////////////////////////
+// @fileoverview The SIMD circle pair kernel against the
+//				 scalar DoCheck of two circles, for batch
+//				 sizes that are not a multiple of the
+//				 width. test/run-tests.sh also builds it
+//				 for AVX2 and AVX-512.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "test-util.h"
+#include "../colliders/circle-batch.h"
+
+using namespace ysd_phy_2d;
+using namespace ysd_phy_2d::test;
+
+namespace
+{
+
+#if defined(__AVX512F__)
+const char* const kTestName = "circle-batch-test (AVX-512)";
+#elif defined(__AVX2__)
+const char* const kTestName = "circle-batch-test (AVX2)";
+#elif defined(__SSE2__)
+const char* const kTestName = "circle-batch-test (SSE2)";
+#else
+const char* const kTestName = "circle-batch-test (scalar)";
+#endif
+
+// Check a batch of count random pairs. Some of them touch exactly, the
+// distance of the centers is the sum of the radius, they do not collide.
+void TestBatch(std::mt19937& rng, std::size_t count)
+{
+	std::uniform_real_distribution<float> position(-10, 10);
+	std::uniform_real_distribution<float> radius(0.1f, 5);
+
+	std::vector<std::unique_ptr<CircleCollider>> colliders1, colliders2;
+	CirclePairBatch batch;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		Vector2 center1(position(rng), position(rng));
+		Vector2 center2(position(rng), position(rng));
+		float radius1 = radius(rng), radius2 = radius(rng);
+		if (i % 5 == 0)
+		{
+			// A 3-4-5 triangle, exact in floats.
+			center1 = Vector2(static_cast<float>(i % 7), 1);
+			center2 = center1 + Vector2(3, 4);
+			radius1 = 2;
+			radius2 = 3;
+		}
+
+		colliders1.emplace_back(new CircleCollider(static_cast<uint16_t>(i), std::make_shared<Circle>(radius1)));
+		colliders1.back()->Translate(center1);
+		colliders2.emplace_back(new CircleCollider(static_cast<uint16_t>(i), std::make_shared<Circle>(radius2)));
+		colliders2.back()->Translate(center2);
+		batch.Push(colliders1.back()->Center(), colliders1.back()->Radius(),
+				   colliders2.back()->Center(), colliders2.back()->Radius());
+	}
+	batch.Check();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		bool expected = DoCheck(*colliders1[i], *colliders2[i]);
+		TEST_CHECK(batch.hit(i) == expected, "%zu pairs: pair %zu is %d, %d expected", count, i, batch.hit(i), expected);
+	}
+}
+
+// The words of the mask past the last pair stay clear.
+void TestMaskTail()
+{
+	const float x[] = { 0, 0, 0, 0, 0 };
+	const float r[] = { 1, 1, 1, 1, 1 };
+	uint64_t hits[1] = { ~uint64_t(0) };
+	CheckCirclePairs(x, x, r, x, x, r, 5, hits);
+	TEST_CHECK(hits[0] == 0x1f, "mask of 5 hits is %llx", static_cast<unsigned long long>(hits[0]));
+}
+
+}
+
+int main()
+{
+#if defined(__AVX512F__)
+	if (!__builtin_cpu_supports("avx512f"))
+	{
+		std::printf("%s: skipped, no AVX-512 on this machine\n", kTestName);
+		return 0;
+	}
+#elif defined(__AVX2__)
+	if (!__builtin_cpu_supports("avx2"))
+	{
+		std::printf("%s: skipped, no AVX2 on this machine\n", kTestName);
+		return 0;
+	}
+#endif
+
+	std::mt19937 rng(11);
+	for (std::size_t count = 0; count <= 70; ++count)
+	{
+		TestBatch(rng, count);
+	}
+	TestBatch(rng, 1000);
+	TestBatch(rng, 1000 + 15);
+	TestMaskTail();
+	return Finish(kTestName);
+}
@@ -0,0 +1,120 @@
+//////////////////////////////////////////////////////
+// @fileoverview Enter, stay and exit of the contact
+//				 table against sets of pairs over frames.
+//				 See test/run-tests.sh.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#include <set>
+#include <random>
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+
+#include "test-util.h"
+#include "../scene/contact-table.h"
+
+using namespace ysd_phy_2d;
+using namespace ysd_phy_2d::test;
+
+namespace
+{
+
+typedef std::pair<uint16_t, uint16_t> Pair;
+
+Pair MakePair(uint16_t id1, uint16_t id2)
+{
+	return id1 < id2 ? std::make_pair(id1, id2) : std::make_pair(id2, id1);
+}
+
+// Random pairs touch over frames, in either order of the ids and some of
+// them twice in a frame. A frame touches no pair now and then, and some
+// ids are near the top of the 16 bits.
+void TestFrames()
+{
+	const int kFrames = 500;
+
+	std::mt19937 rng(16);
+	std::uniform_int_distribution<int> ids(0, 40);
+	std::uniform_int_distribution<int> counts(0, 150);
+
+	// Start small, the table has to grow.
+	ContactTable table(4);
+	std::set<Pair> last;
+	for (int frame = 0; frame < kFrames; ++frame)
+	{
+		table.BeginFrame();
+
+		std::set<Pair> current;
+		int count = frame % 50 == 49 ? 0 : counts(rng);
+		for (int i = 0; i < count; ++i)
+		{
+			uint16_t id1 = static_cast<uint16_t>(ids(rng));
+			uint16_t id2 = static_cast<uint16_t>(ids(rng));
+			if (id1 == id2)
+				continue;
+			if (id1 % 8 == 0)
+				id1 = static_cast<uint16_t>(0xffff - id1);
+
+			Pair pair = MakePair(id1, id2);
+			bool expected = last.count(pair) == 0 && current.count(pair) == 0;
+			bool entered = table.Touch(id1, id2);
+			TEST_CHECK(entered == expected, "frame %d: touch of (%u, %u) is %d, %d expected", frame, id1, id2,
+					   entered, expected);
+			current.insert(pair);
+		}
+
+		std::vector<Pair> exits;
+		table.EndFrame([&](uint16_t id1, uint16_t id2) {
+			TEST_CHECK(id1 < id2, "frame %d: exit of (%u, %u) is not ordered", frame, id1, id2);
+			exits.push_back(MakePair(id1, id2));
+		});
+		std::sort(exits.begin(), exits.end());
+
+		std::vector<Pair> expected_exits;
+		std::set_difference(last.begin(), last.end(), current.begin(), current.end(),
+							std::back_inserter(expected_exits));
+		TEST_CHECK(exits == expected_exits, "frame %d: %zu exits, %zu expected", frame, exits.size(),
+				   expected_exits.size());
+		TEST_CHECK(table.size() == current.size(), "frame %d: %zu pairs, %zu expected", frame, table.size(),
+				   current.size());
+
+		last.swap(current);
+	}
+}
+
+// A pair that exits and touches again in the next frame enters again.
+void TestReenter()
+{
+	ContactTable table;
+	int exits = 0;
+	auto on_exit = [&](uint16_t, uint16_t) { ++exits; };
+
+	table.BeginFrame();
+	TEST_CHECK(table.Touch(1, 2), "first touch does not enter");
+	table.EndFrame(on_exit);
+
+	table.BeginFrame();
+	TEST_CHECK(!table.Touch(2, 1), "touch in the next frame enters");
+	table.EndFrame(on_exit);
+
+	table.BeginFrame();
+	table.EndFrame(on_exit);
+	TEST_CHECK(exits == 1 && table.size() == 0, "%d exits, %zu pairs after a frame without the pair", exits,
+			   table.size());
+
+	table.BeginFrame();
+	TEST_CHECK(table.Touch(1, 2), "touch after the exit does not enter");
+	table.EndFrame(on_exit);
+	TEST_CHECK(exits == 1 && table.size() == 1, "%d exits, %zu pairs after the enter", exits, table.size());
+}
+
+}
+
+int main()
+{
+	TestFrames();
+	TestReenter();
+	return Finish("contact-table-test");
+}
@@ -0,0 +1,213 @@
+//////////////////////////////////////////////////////
+// @fileoverview The collisions and events of the world
+//				 API come in the same order whatever the
+//				 number of threads. See test/run-tests.sh.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#include <cstring>
+#include <random>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "test-util.h"
+#include "../cdsys-main.cc"
+
+using namespace ysd_phy_2d;
+using namespace ysd_phy_2d::test;
+
+namespace
+{
+
+const float kHalfSize = 200;
+const uint16_t kCircleCount = 1500;
+const uint16_t kPolygonCount = 500;
+const int kFrameCount = 30;
+
+// What a run delivered, folded by FNV-1a.
+struct RunResult
+{
+	uint64_t hash;
+	uint64_t collisions;
+	uint64_t events;
+};
+
+RunResult g_result = { 14695981039346656037ull, 0, 0 };
+
+void Fold(const void* data, std::size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		g_result.hash = (g_result.hash ^ bytes[i]) * 1099511628211ull;
+	}
+}
+
+void FoldCollision(const Collision& collision)
+{
+	float values[] = { collision.normal.x(), collision.normal.y(), collision.depth, collision.time_of_impact };
+	Fold(&collision.first, sizeof(collision.first));
+	Fold(&collision.second, sizeof(collision.second));
+	Fold(values, sizeof(values));
+	Fold(&collision.point_count, sizeof(collision.point_count));
+}
+
+void FoldEvent(OnDetectedCallbackType type, uint16_t id, uint16_t first, uint16_t second)
+{
+	uint16_t values[] = { static_cast<uint16_t>(type), id, first, second };
+	Fold(values, sizeof(values));
+	++g_result.events;
+}
+
+// Build the world and step it, in a fresh process since the world can
+// only be created once.
+void RunScene(BroadPhaseType type, float looseness, uint32_t threads, EventDelivery delivery)
+{
+	CreateWorld(type, kHalfSize * 2, kHalfSize * 2, 16, looseness);
+	SetThreadCount(threads);
+	SetEventDelivery(delivery);
+
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> position(-kHalfSize, kHalfSize);
+	std::uniform_real_distribution<float> size(1, 4);
+
+	std::vector<CircleColliderDesc> circles(kCircleCount);
+	for (uint16_t i = 0; i < kCircleCount; ++i)
+	{
+		CircleColliderDesc& desc = circles[i];
+		desc.id = i;
+		desc.pos_x = position(rng);
+		desc.pos_y = position(rng);
+		desc.radius = size(rng);
+		for (int t = kOnColliderEnter; t <= kOnColliderExit; ++t)
+		{
+			OnDetectedCallbackType callback_type = static_cast<OnDetectedCallbackType>(t);
+			desc.callbacks[t - 1] = [i, callback_type](const Collision& collision) {
+				FoldEvent(callback_type, i, collision.first, collision.second);
+			};
+		}
+	}
+	AddCircleColliders(circles.data(), circles.size());
+
+	for (uint16_t i = 0; i < kPolygonCount; ++i)
+	{
+		float k = size(rng);
+		float xy[] = { -2 * k, -2 * k, 2 * k, -2 * k, 3 * k, k, 0, 3 * k, -2 * k, k };
+		AddPolygonCollider(kCircleCount + i, position(rng), position(rng), xy, 10);
+	}
+
+	// A few bullets go through the others.
+	for (uint16_t i = 0; i < kCircleCount; i += 50)
+	{
+		SetContinuous(i, true);
+	}
+
+	const uint16_t count = kCircleCount + kPolygonCount;
+	std::vector<uint16_t> ids(count);
+	std::vector<float> positions(count * 2), angles(count);
+	for (uint16_t i = 0; i < count; ++i)
+	{
+		ids[i] = i;
+		ColliderHandle handle = g_collider_pool.Find(i);
+		positions[i * 2] = g_collider_pool.position(handle).x();
+		positions[i * 2 + 1] = g_collider_pool.position(handle).y();
+	}
+
+	std::uniform_real_distribution<float> move(-1.5f, 1.5f);
+	std::uniform_real_distribution<float> turn(-0.2f, 0.2f);
+	for (int frame = 0; frame < kFrameCount; ++frame)
+	{
+		for (uint16_t i = 0; i < count; ++i)
+		{
+			float range = i < kCircleCount && i % 50 == 0 ? 20.0f : 1.0f;
+			positions[i * 2] += move(rng) * range;
+			positions[i * 2 + 1] += move(rng) * range;
+			angles[i] += turn(rng);
+		}
+		SetTransforms(ids.data(), positions.data(), angles.data(), nullptr, count);
+		Update();
+
+		for (const Collision& collision : GetCollisions())
+		{
+			FoldCollision(collision);
+			++g_result.collisions;
+		}
+
+		if (delivery == kStreamDelivery)
+		{
+			for (int t = kOnColliderEnter; t <= kOnColliderExit; ++t)
+			{
+				OnDetectedCallbackType event_type = static_cast<OnDetectedCallbackType>(t);
+				for (const ContactEvent& event : GetEvents(event_type))
+				{
+					FoldEvent(event_type, 0, event.first, event.second);
+					Fold(&event.collision, sizeof(event.collision));
+				}
+			}
+		}
+	}
+}
+
+// Run the scene in a child process and read back its result.
+bool RunInChild(BroadPhaseType type, float looseness, uint32_t threads, EventDelivery delivery, RunResult* result)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+		return false;
+
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		close(fds[0]);
+		RunScene(type, looseness, threads, delivery);
+		ssize_t written = write(fds[1], &g_result, sizeof(g_result));
+		_exit(written == sizeof(g_result) ? 0 : 1);
+	}
+
+	close(fds[1]);
+	ssize_t read_size = pid > 0 ? read(fds[0], result, sizeof(*result)) : 0;
+	close(fds[0]);
+	int status = 1;
+	if (pid > 0)
+		waitpid(pid, &status, 0);
+	return read_size == sizeof(*result) && status == 0;
+}
+
+void TestThreadCounts(const char* name, BroadPhaseType type, float looseness, EventDelivery delivery)
+{
+	const uint32_t kThreadCounts[] = { 1, 3, 8 };
+	RunResult expected = {};
+	for (uint32_t threads : kThreadCounts)
+	{
+		RunResult result;
+		bool ran = RunInChild(type, looseness, threads, delivery, &result);
+		TEST_CHECK(ran, "%s with %u threads did not finish", name, threads);
+		if (!ran)
+			continue;
+
+		if (threads == 1)
+		{
+			expected = result;
+			TEST_CHECK(result.collisions > 0 && result.events > 0, "%s: %llu collisions, %llu events", name,
+					   static_cast<unsigned long long>(result.collisions), static_cast<unsigned long long>(result.events));
+			continue;
+		}
+		TEST_CHECK(std::memcmp(&result, &expected, sizeof(result)) == 0,
+				   "%s with %u threads: %llu collisions, %llu events, %llu and %llu with 1 thread", name, threads,
+				   static_cast<unsigned long long>(result.collisions), static_cast<unsigned long long>(result.events),
+				   static_cast<unsigned long long>(expected.collisions), static_cast<unsigned long long>(expected.events));
+	}
+}
+
+}
+
+int main()
+{
+	TestThreadCounts("strict quad tree, callbacks", kQuadTreeBroadPhase, 1, kCallbackDelivery);
+	TestThreadCounts("loose quad tree, callbacks", kQuadTreeBroadPhase, 2, kCallbackDelivery);
+	TestThreadCounts("sweep and prune, callbacks", kSweepAndPruneBroadPhase, 1, kCallbackDelivery);
+	TestThreadCounts("strict quad tree, stream", kQuadTreeBroadPhase, 1, kStreamDelivery);
+	TestThreadCounts("loose quad tree, stream", kQuadTreeBroadPhase, 2, kStreamDelivery);
+	TestThreadCounts("sweep and prune, stream", kSweepAndPruneBroadPhase, 1, kStreamDelivery);
+	return Finish("event-order-test");
+}
@@ -0,0 +1,194 @@
+//////////////////////////////////////////////////////
+// @fileoverview Warm started GJK against a cold start
+//				 over frames of moving polygons, and the
+//				 GJK cache against a map. See
+//				 test/run-tests.sh.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "test-util.h"
+#include "../colliders/gjk-cache.h"
+
+using namespace ysd_phy_2d;
+using namespace ysd_phy_2d::test;
+
+namespace
+{
+
+const float kPi = 3.14159265f;
+
+// A regular polygon, some of them above kHillClimbVertices.
+std::unique_ptr<PolygonCollider> MakePolygon(uint16_t id, std::size_t size, float radius)
+{
+	std::vector<Vector2> corners;
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		float a = 2 * kPi * i / size;
+		corners.push_back(Vector2(radius * std::cos(a), radius * std::sin(a)));
+	}
+	return std::unique_ptr<PolygonCollider>(
+		new PolygonCollider(id, std::make_shared<ConvexPolygon>(corners.data(), corners.size())));
+}
+
+// Pairs of polygons orbit each other, in and out of contact. Every frame
+// each pair is checked warm started from the cache and cold, in either
+// order of the arguments.
+void TestWarmStart()
+{
+	const int kPairCount = 300;
+	const int kFrames = 100;
+	const Vector2 kScale(1, 1);
+
+	std::mt19937 rng(14);
+	std::uniform_int_distribution<int> sizes(3, 40);
+	std::uniform_real_distribution<float> radius(0.5f, 3);
+	std::uniform_real_distribution<float> phase(0, 2 * kPi);
+	std::uniform_real_distribution<float> speed(-0.2f, 0.2f);
+
+	std::vector<std::unique_ptr<PolygonCollider>> polygons;
+	std::vector<float> orbits, phases, speeds, spins;
+	for (int i = 0; i < kPairCount; ++i)
+	{
+		float r1 = radius(rng), r2 = radius(rng);
+		polygons.push_back(MakePolygon(static_cast<uint16_t>(2 * i), sizes(rng), r1));
+		polygons.push_back(MakePolygon(static_cast<uint16_t>(2 * i + 1), sizes(rng), r2));
+
+		// The distance of the centers swings around the sum of the radius.
+		orbits.push_back(r1 + r2);
+		phases.push_back(phase(rng));
+		speeds.push_back(speed(rng));
+		spins.push_back(speed(rng));
+	}
+
+	GjkCache cache(64);
+	int hits = 0, trials = 0;
+	for (int frame = 0; frame < kFrames; ++frame)
+	{
+		for (int i = 0; i < kPairCount; ++i)
+		{
+			PolygonCollider& polygon1 = *polygons[2 * i];
+			PolygonCollider& polygon2 = *polygons[2 * i + 1];
+			float a = phases[i] + speeds[i] * frame;
+			float distance = orbits[i] * (0.9f + 0.3f * std::sin(a * 1.7f));
+			polygon1.SetTransform(Vector2::kZero, spins[i] * frame, kScale);
+			polygon2.SetTransform(Vector2(std::cos(a), std::sin(a)) * distance, -spins[i] * frame, kScale);
+
+			bool swap = (frame + i) % 3 == 0;
+			PolygonCollider& first = swap ? polygon2 : polygon1;
+			PolygonCollider& second = swap ? polygon1 : polygon2;
+
+			Collision warm_collision, cold_collision;
+			uint32_t entry = cache.Get(first.id(), second.id());
+			bool warm = DoCheck(first, second, &cache.warm(entry), &warm_collision);
+			bool cold = DoCheck(first, second, nullptr, &cold_collision);
+
+			++trials;
+			TEST_CHECK(warm == cold, "pair %d at frame %d: warm %d, cold %d", i, frame, warm, cold);
+			if (!warm || !cold)
+				continue;
+
+			++hits;
+			TEST_CHECK(std::fabs(warm_collision.depth - cold_collision.depth) <= 1e-3f * (1 + cold_collision.depth),
+					   "pair %d at frame %d: warm depth %g, cold depth %g", i, frame, warm_collision.depth,
+					   cold_collision.depth);
+		}
+		cache.EndFrame();
+		TEST_CHECK(cache.size() == static_cast<std::size_t>(kPairCount), "%zu entries for %d pairs", cache.size(),
+				   kPairCount);
+	}
+	TEST_CHECK(hits > trials / 4 && hits < trials * 3 / 4, "%d of %d checks hit", hits, trials);
+}
+
+// Random pairs are got over frames with random ages, the cache keeps the
+// same pairs as a map and every entry keeps its warm start through the
+// erases and the growth of the table.
+void TestTable()
+{
+	const int kFrames = 400;
+	const uint16_t kIds = 24;
+
+	std::mt19937 rng(15);
+	std::uniform_int_distribution<int> ids(0, kIds - 1);
+	std::uniform_int_distribution<int> counts(0, 80);
+	std::uniform_int_distribution<uint32_t> ages(1, 3);
+
+	// The marker written into the warm start and the last frame of a pair.
+	struct Expected
+	{
+		float marker;
+		uint32_t frame;
+	};
+	std::map<std::pair<uint16_t, uint16_t>, Expected> expected;
+
+	// Start small, the table has to grow.
+	GjkCache cache(4);
+	float marker = 0;
+	for (uint32_t frame = 0; frame < kFrames; ++frame)
+	{
+		int count = counts(rng);
+		for (int i = 0; i < count; ++i)
+		{
+			uint16_t id1 = static_cast<uint16_t>(ids(rng));
+			uint16_t id2 = static_cast<uint16_t>(ids(rng));
+			if (id1 == id2)
+				continue;
+
+			std::pair<uint16_t, uint16_t> key = id1 < id2 ? std::make_pair(id1, id2) : std::make_pair(id2, id1);
+			uint32_t entry = cache.Get(id1, id2);
+			TEST_CHECK(entry == cache.Get(id2, id1), "frame %u: (%u, %u) has two entries", frame, id1, id2);
+
+			GjkWarmStart& warm = cache.warm(entry);
+			auto it = expected.find(key);
+			if (it == expected.end())
+			{
+				TEST_CHECK(!warm.valid, "frame %u: new pair (%u, %u) has a valid warm start", frame, id1, id2);
+			}
+			else
+			{
+				TEST_CHECK(warm.valid && warm.dir.x() == it->second.marker, "frame %u: pair (%u, %u) has %g, %g expected",
+						   frame, id1, id2, warm.dir.x(), it->second.marker);
+			}
+
+			marker += 1;
+			warm.valid = true;
+			warm.dir = Vector2(marker, 0);
+			expected[key] = Expected{ marker, frame };
+		}
+
+		uint32_t max_age = ages(rng);
+		cache.EndFrame(max_age);
+		for (auto it = expected.begin(); it != expected.end();)
+		{
+			if (frame - it->second.frame >= max_age)
+				it = expected.erase(it);
+			else
+				++it;
+		}
+		TEST_CHECK(cache.size() == expected.size(), "frame %u: %zu entries, %zu expected", frame, cache.size(),
+				   expected.size());
+	}
+
+	// Clear leaves nothing to find.
+	cache.Clear();
+	TEST_CHECK(cache.size() == 0, "%zu entries after clear", cache.size());
+	for (const auto& pair : expected)
+	{
+		uint32_t entry = cache.Get(pair.first.first, pair.first.second);
+		TEST_CHECK(!cache.warm(entry).valid, "(%u, %u) found after clear", pair.first.first, pair.first.second);
+	}
+}
+
+}
+
+int main()
+{
+	TestWarmStart();
+	TestTable();
+	return Finish("gjk-cache-test");
+}
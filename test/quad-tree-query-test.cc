@@ -0,0 +1,210 @@
+//////////////////////////////////////////////////////
+// @fileoverview Region, point, ray, nearest and radius
+//				 queries of the quad tree against brute
+//				 force. See test/run-tests.sh.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#include <cmath>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "test-util.h"
+#include "../colliders/raycast.h"
+#include "../colliders/distance.h"
+#include "../scene/quad-tree.h"
+
+using namespace ysd_phy_2d;
+using namespace ysd_phy_2d::test;
+
+namespace
+{
+
+const float kHalfSize = 200;
+const uint16_t kColliderCount = 3000;
+const int kQueryCount = 500;
+
+// The ids of the live colliders a predicate holds for, sorted.
+template <typename Predicate>
+std::vector<uint16_t> BruteForceIds(const ColliderPool& pool, Predicate predicate)
+{
+	std::vector<uint16_t> ids;
+	for (ColliderHandle handle = 0; handle < pool.capacity(); ++handle)
+	{
+		if (pool.collider(handle) != nullptr && predicate(handle))
+			ids.push_back(pool.id(handle));
+	}
+	std::sort(ids.begin(), ids.end());
+	return ids;
+}
+
+std::vector<uint16_t> SortedIds(const std::vector<uint16_t>& ids, std::size_t count)
+{
+	std::vector<uint16_t> result(ids.begin(), ids.begin() + std::min(count, ids.size()));
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+// A scene with colliders out of the world, moved once so that some of
+// them changed their nodes.
+void BuildScene(ColliderPool& pool, QuadTree& tree, RandomScene& scene)
+{
+	for (uint16_t id = 0; id < kColliderCount; ++id)
+	{
+		tree.Insert(scene.Add(pool, id));
+	}
+	for (ColliderHandle handle = 0; handle < pool.capacity(); handle += 3)
+	{
+		pool.Translate(handle, scene.Jitter(30));
+		tree.Refit(handle);
+	}
+}
+
+void TestRegionAndPoint(const char* name, const ColliderPool& pool, QuadTree& tree, RandomScene& scene)
+{
+	std::vector<uint16_t> ids(kColliderCount);
+	std::vector<Bound> regions;
+	for (int i = 0; i < kQueryCount; ++i)
+	{
+		Vector2 center = scene.Point(1.3f), extent = scene.Jitter(40);
+		Vector2 half(std::fabs(extent.x()), std::fabs(extent.y()));
+		Bound region{ center - half, center + half };
+		regions.push_back(region);
+
+		std::size_t count = tree.QueryRegion(region, ids.data(), ids.size());
+		auto expected = BruteForceIds(pool, [&](ColliderHandle handle) {
+			return BoundContactBound(region, pool.bound(handle));
+		});
+		TEST_CHECK(SortedIds(ids, count) == expected, "%s region %d: %zu colliders, %zu expected", name, i, count, expected.size());
+
+		Vector2 point = scene.Point(1.3f);
+		count = tree.QueryPoint(point, ids.data(), ids.size());
+		expected = BruteForceIds(pool, [&](ColliderHandle handle) {
+			return PointInBound(pool.bound(handle), point);
+		});
+		TEST_CHECK(SortedIds(ids, count) == expected, "%s point %d: %zu colliders, %zu expected", name, i, count, expected.size());
+	}
+
+	// The regions in one walk find the same as one by one.
+	std::vector<uint32_t> offsets(regions.size() + 1);
+	std::size_t total = tree.QueryRegions(regions.data(), regions.size(), nullptr, 0, offsets.data());
+	std::vector<uint16_t> all(total);
+	tree.QueryRegions(regions.data(), regions.size(), all.data(), all.size(), offsets.data());
+	for (std::size_t i = 0; i < regions.size(); ++i)
+	{
+		std::size_t count = tree.QueryRegion(regions[i], ids.data(), ids.size());
+		std::vector<uint16_t> batch(all.begin() + offsets[i], all.begin() + offsets[i + 1]);
+		std::sort(batch.begin(), batch.end());
+		TEST_CHECK(batch == SortedIds(ids, count), "%s regions %zu: %zu colliders, %zu one by one", name, i, batch.size(), count);
+	}
+}
+
+void TestRaycast(const char* name, const ColliderPool& pool, QuadTree& tree, RandomScene& scene)
+{
+	std::vector<Ray> rays;
+	for (int i = 0; i < kQueryCount; ++i)
+	{
+		Ray ray;
+		ray.origin = scene.Point(1.3f);
+		ray.direction = scene.Point(1.3f) - ray.origin;
+		ray.max_fraction = i % 2 == 0 ? 1 : 0.5f;
+		rays.push_back(ray);
+
+		// The nearest hit of all colliders.
+		RaycastHit expected;
+		expected.fraction = ray.max_fraction;
+		bool expected_hit = false;
+		for (ColliderHandle handle = 0; handle < pool.capacity(); ++handle)
+		{
+			RaycastHit candidate;
+			if (pool.collider(handle) != nullptr && Raycast(*pool.collider(handle), ray, &candidate) &&
+				(!expected_hit || candidate.fraction < expected.fraction))
+			{
+				expected = candidate;
+				expected_hit = true;
+			}
+		}
+
+		RaycastHit found;
+		bool hit = tree.Raycast(ray, &found);
+		TEST_CHECK(hit == expected_hit, "%s ray %d: hit %d, %d expected", name, i, hit, expected_hit);
+		if (hit && expected_hit)
+		{
+			TEST_CHECK(found.fraction == expected.fraction, "%s ray %d: fraction %g, %g expected", name, i,
+					   found.fraction, expected.fraction);
+		}
+	}
+
+	// The batch finds the same hits as one by one.
+	std::vector<RaycastHit> hits(rays.size());
+	std::vector<uint64_t> hit_bits((rays.size() + 63) / 64);
+	tree.RaycastBatch(rays.data(), rays.size(), hits.data(), hit_bits.data());
+	for (std::size_t i = 0; i < rays.size(); ++i)
+	{
+		RaycastHit found;
+		bool hit = tree.Raycast(rays[i], &found);
+		bool batch_hit = (hit_bits[i / 64] >> (i % 64)) & 1;
+		TEST_CHECK(batch_hit == hit, "%s batch ray %zu: hit %d, %d one by one", name, i, batch_hit, hit);
+		if (hit && batch_hit)
+		{
+			TEST_CHECK(hits[i].id == found.id && hits[i].fraction == found.fraction, "%s batch ray %zu: hit differs", name, i);
+		}
+	}
+}
+
+void TestNearestAndRadius(const char* name, const ColliderPool& pool, QuadTree& tree, RandomScene& scene)
+{
+	const std::size_t kNearest = 12;
+	std::vector<uint16_t> ids(kColliderCount);
+	std::vector<float> distances(kNearest);
+	for (int i = 0; i < kQueryCount; ++i)
+	{
+		Vector2 point = scene.Point(1.3f);
+
+		// The nearest by distance, then by id.
+		std::vector<std::pair<float, uint16_t>> all;
+		for (ColliderHandle handle = 0; handle < pool.capacity(); ++handle)
+		{
+			if (pool.collider(handle) != nullptr)
+				all.emplace_back(Distance(*pool.collider(handle), point), pool.id(handle));
+		}
+		std::sort(all.begin(), all.end());
+
+		std::size_t count = tree.QueryNearest(point, kNearest, ids.data(), distances.data());
+		TEST_CHECK(count == kNearest, "%s nearest %d: %zu colliders", name, i, count);
+		for (std::size_t j = 0; j < count && j < all.size(); ++j)
+		{
+			TEST_CHECK(ids[j] == all[j].second && distances[j] == all[j].first, "%s nearest %d: %zuth is %u at %g, %u at %g expected",
+					   name, i, j, ids[j], distances[j], all[j].second, all[j].first);
+		}
+
+		float radius = std::fabs(scene.Jitter(25).x());
+		count = tree.QueryRadius(point, radius, ids.data(), ids.size());
+		auto expected = BruteForceIds(pool, [&](ColliderHandle handle) {
+			return Distance(*pool.collider(handle), point) <= radius;
+		});
+		TEST_CHECK(SortedIds(ids, count) == expected, "%s radius %d: %zu colliders, %zu expected", name, i, count, expected.size());
+	}
+}
+
+void TestQueries(const char* name, float looseness)
+{
+	ColliderPool pool;
+	QuadTree tree(&pool, kHalfSize * 2, kHalfSize * 2, 8, looseness);
+	RandomScene scene(3, kHalfSize);
+	BuildScene(pool, tree, scene);
+
+	TestRegionAndPoint(name, pool, tree, scene);
+	TestRaycast(name, pool, tree, scene);
+	TestNearestAndRadius(name, pool, tree, scene);
+}
+
+}
+
+int main()
+{
+	TestQueries("strict quad tree", 1);
+	TestQueries("loose quad tree", 2);
+	return Finish("quad-tree-query-test");
+}
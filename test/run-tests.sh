@@ -0,0 +1,38 @@
+#!/bin/sh
+# Build and run the regression tests. Run from anywhere:
+#   sh test/run-tests.sh [extra compiler flags...]
+# e.g. sh test/run-tests.sh -fsanitize=address,undefined
+cd "$(dirname "$0")/.." || exit 1
+
+CXX=${CXX:-g++}
+OUT=${OUT:-/tmp/phy-2d-tests}
+SOURCES="math/vector_2.cc common/thread-pool.cc $(ls colliders/*.cc scene/*.cc | grep -v 'colliders/shape.cc')"
+
+mkdir -p "$OUT"
+status=0
+
+# run_test <test source> <binary name> [compiler flags...]
+run_test() {
+	test=$1
+	name=$2
+	shift 2
+	if ! $CXX -std=c++14 -O2 -g -pthread "$@" "$test" $SOURCES -o "$OUT/$name"; then
+		echo "$name: build FAILED"
+		status=1
+		return
+	fi
+	"$OUT/$name" || status=1
+}
+
+for test in test/*-test.cc; do
+	run_test "$test" "$(basename "$test" .cc)" "$@"
+done
+
+# The SIMD kernels are only compiled for the instruction sets the flags
+# enable, build them for the wider ones too. A test skips itself on a
+# machine without them.
+run_test test/circle-batch-test.cc circle-batch-test-avx2 -mavx2 "$@"
+run_test test/circle-batch-test.cc circle-batch-test-avx512 -mavx512f "$@"
+run_test test/support-test.cc support-test-avx2 -mavx2 "$@"
+
+exit $status
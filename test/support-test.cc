@@ -0,0 +1,161 @@
+//////////////////////////////////////////////////////
+// @fileoverview The vectorized scan and the hill climb
+//				 of the support mapping against a plain
+//				 linear scan. test/run-tests.sh also
+//				 builds it for AVX2.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "test-util.h"
+#include "../colliders/support.h"
+
+using namespace ysd_phy_2d;
+using namespace ysd_phy_2d::test;
+
+namespace
+{
+
+#if defined(__AVX2__)
+const char* const kTestName = "support-test (AVX2)";
+#elif defined(__SSE2__)
+const char* const kTestName = "support-test (SSE2)";
+#else
+const char* const kTestName = "support-test (scalar)";
+#endif
+
+const float kPi = 3.14159265f;
+
+// A convex polygon anticlockwise as structure of arrays.
+struct Polygon
+{
+	const char* name;
+	std::vector<float> xs;
+	std::vector<float> ys;
+
+	void Add(float x, float y)
+	{
+		xs.push_back(x);
+		ys.push_back(y);
+	}
+};
+
+// A regular polygon of a radius, rotated.
+Polygon Regular(std::size_t size, float radius, float angle)
+{
+	Polygon polygon{ "regular", {}, {} };
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		float a = angle + 2 * kPi * i / size;
+		polygon.Add(radius * std::cos(a), radius * std::sin(a));
+	}
+	return polygon;
+}
+
+// A square with points on its edges, every edge is a flat run of
+// per_edge + 1 collinear vertices.
+Polygon SubdividedSquare(std::size_t per_edge)
+{
+	Polygon polygon{ "subdivided square", {}, {} };
+	const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+	for (std::size_t c = 0; c < 4; ++c)
+	{
+		const float* a = corners[c];
+		const float* b = corners[(c + 1) % 4];
+		for (std::size_t i = 0; i < per_edge; ++i)
+		{
+			float t = static_cast<float>(i) / per_edge;
+			polygon.Add(a[0] + (b[0] - a[0]) * t, a[1] + (b[1] - a[1]) * t);
+		}
+	}
+	return polygon;
+}
+
+// Check both searches for a direction, the hill climb from every start.
+void CheckDirection(const Polygon& polygon, const Vector2& dir)
+{
+	const std::size_t size = polygon.xs.size();
+	const float* xs = polygon.xs.data();
+	const float* ys = polygon.ys.data();
+
+	std::size_t first = 0;
+	float best = xs[0] * dir.x() + ys[0] * dir.y();
+	for (std::size_t i = 1; i < size; ++i)
+	{
+		float dot = xs[i] * dir.x() + ys[i] * dir.y();
+		if (dot > best)
+		{
+			best = dot;
+			first = i;
+		}
+	}
+
+	std::size_t index = IndexOfFurthestPoint(xs, ys, size, dir);
+	TEST_CHECK(index == first, "%s of %zu along (%g, %g): index %zu, %zu expected", polygon.name, size,
+			   dir.x(), dir.y(), index, first);
+
+	for (std::size_t start = 0; start < size; ++start)
+	{
+		std::size_t climbed = HillClimbFurthestPoint(xs, ys, size, dir, start);
+		float dot = xs[climbed] * dir.x() + ys[climbed] * dir.y();
+		TEST_CHECK(climbed < size && dot == best, "%s of %zu along (%g, %g) from %zu: %zu at %g, %g expected",
+				   polygon.name, size, dir.x(), dir.y(), start, climbed, dot, best);
+	}
+}
+
+void CheckPolygon(std::mt19937& rng, const Polygon& polygon)
+{
+	std::uniform_real_distribution<float> angle(0, 2 * kPi);
+	for (int i = 0; i < 32; ++i)
+	{
+		float a = angle(rng);
+		CheckDirection(polygon, Vector2(std::cos(a), std::sin(a)));
+	}
+
+	// Along the axes and the diagonals an edge of the squares is
+	// perpendicular to the direction, at the furthest and the nearest side.
+	for (int i = 0; i < 8; ++i)
+	{
+		float a = kPi / 4 * i;
+		CheckDirection(polygon, Vector2(std::round(std::cos(a)), std::round(std::sin(a))));
+	}
+}
+
+}
+
+int main()
+{
+#if defined(__AVX2__)
+	if (!__builtin_cpu_supports("avx2"))
+	{
+		std::printf("%s: skipped, no AVX2 on this machine\n", kTestName);
+		return 0;
+	}
+#endif
+
+	std::mt19937 rng(12);
+	std::uniform_real_distribution<float> angle(0, 2 * kPi);
+
+	// Below and above kHillClimbVertices, and every tail of the SIMD width.
+	for (std::size_t size = 3; size <= 2 * kHillClimbVertices + 9; ++size)
+	{
+		CheckPolygon(rng, Regular(size, 5, angle(rng)));
+	}
+	CheckPolygon(rng, Regular(100, 50, angle(rng)));
+
+	// Regular polygons with an edge perpendicular to the axes.
+	CheckPolygon(rng, Regular(4, 2, kPi / 4));
+	CheckPolygon(rng, Regular(20, 2, kPi / 20));
+	CheckPolygon(rng, Regular(40, 2, kPi / 40));
+
+	// Flat runs of collinear vertices.
+	for (std::size_t per_edge = 1; per_edge <= 12; ++per_edge)
+	{
+		CheckPolygon(rng, SubdividedSquare(per_edge));
+	}
+
+	return Finish(kTestName);
+}
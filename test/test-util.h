@@ -0,0 +1,150 @@
+//////////////////////////////////////////////////////
+// @fileoverview Helpers of the regression tests: a
+//				 check macro, random scenes and brute
+//				 force references.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#ifndef _TEST_UTIL_H_
+#define _TEST_UTIL_H_
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <random>
+#include <utility>
+#include <algorithm>
+
+#include "../math/vector_2.h"
+#include "../math/bound.h"
+#include "../colliders/collider.h"
+#include "../colliders/shapes.h"
+#include "../scene/collider-pool.h"
+#include "../scene/collider-pair.h"
+
+namespace ysd_phy_2d
+{
+namespace test
+{
+
+// Number of failed checks of the test program.
+static int g_failures = 0;
+
+// Report a failed check and go on, the test returns the failures.
+#define TEST_CHECK(condition, ...)												\
+	do																			\
+	{																			\
+		if (!(condition))														\
+		{																		\
+			++::ysd_phy_2d::test::g_failures;									\
+			std::printf("%s:%d: %s failed: ", __FILE__, __LINE__, #condition);	\
+			std::printf(__VA_ARGS__);											\
+			std::printf("\n");													\
+		}																		\
+	} while (0)
+
+// Print the result of the test program, the exit code of main.
+inline int Finish(const char* name)
+{
+	std::printf("%s: %s\n", name, g_failures == 0 ? "passed" : "FAILED");
+	return g_failures == 0 ? 0 : 1;
+}
+
+// A scene of random circles and pentagons, some of them big and some
+// of them across or out of the world's edge.
+class RandomScene
+{
+public:
+	// @param[in]	half_size	The world is [-half_size, half_size]^2.
+	RandomScene(uint32_t seed, float half_size)
+		: rng_(seed), half_size_(half_size)
+	{}
+
+	// Add a collider to the pool. Every 64th is out of the world, every
+	// 97th is 20 times bigger than the others.
+	ColliderHandle Add(ColliderPool& pool, uint16_t id)
+	{
+		std::uniform_real_distribution<float> position(-half_size_, half_size_);
+		std::uniform_real_distribution<float> size(0.5f, 3);
+		std::uniform_real_distribution<float> angle(0, 6.28f);
+
+		float k = size(rng_) * (id % 97 == 0 ? 20 : 1);
+		Vector2 at(position(rng_), position(rng_));
+		if (id % 64 == 0)
+			at = at * 1.2f + Vector2(half_size_ * 0.3f, 0);
+
+		std::unique_ptr<BaseCollider> collider;
+		if (id % 2 == 0)
+		{
+			collider.reset(new CircleCollider(id, std::make_shared<Circle>(k)));
+		}
+		else
+		{
+			Vector2 corners[] = { Vector2(-2 * k, -2 * k), Vector2(2 * k, -2 * k), Vector2(3 * k, k),
+								  Vector2(0, 3 * k), Vector2(-2 * k, k) };
+			collider.reset(new PolygonCollider(id, std::make_shared<ConvexPolygon>(corners, 5)));
+			collider->Rotate(angle(rng_));
+		}
+		collider->Translate(at);
+		return pool.Add(std::move(collider));
+	}
+
+	// A small random move.
+	Vector2 Jitter(float range)
+	{
+		std::uniform_real_distribution<float> move(-range, range);
+		return Vector2(move(rng_), move(rng_));
+	}
+
+	Vector2 Point(float scale = 1)
+	{
+		std::uniform_real_distribution<float> position(-half_size_ * scale, half_size_ * scale);
+		return Vector2(position(rng_), position(rng_));
+	}
+
+	std::mt19937& rng() { return rng_; }
+
+private:
+	std::mt19937 rng_;
+	float half_size_;
+};
+
+// Pairs as sorted (smaller id, bigger id), comparable whatever the order
+// the broad phase found them in.
+inline std::vector<std::pair<uint16_t, uint16_t>> SortedPairs(const ColliderPool& pool, const PairBuffer& pairs)
+{
+	std::vector<std::pair<uint16_t, uint16_t>> result;
+	for (const ColliderPair& pair : pairs)
+	{
+		uint16_t a = pool.id(pair.first), b = pool.id(pair.second);
+		result.push_back(a < b ? std::make_pair(a, b) : std::make_pair(b, a));
+	}
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+// All pairs of the live colliders whose bounds contact.
+inline std::vector<std::pair<uint16_t, uint16_t>> BruteForcePairs(const ColliderPool& pool)
+{
+	std::vector<std::pair<uint16_t, uint16_t>> result;
+	for (ColliderHandle i = 0; i < pool.capacity(); ++i)
+	{
+		if (pool.collider(i) == nullptr)
+			continue;
+		for (ColliderHandle j = i + 1; j < pool.capacity(); ++j)
+		{
+			if (pool.collider(j) == nullptr || !BoundContactBound(pool.bound(i), pool.bound(j)))
+				continue;
+			uint16_t a = pool.id(i), b = pool.id(j);
+			result.push_back(a < b ? std::make_pair(a, b) : std::make_pair(b, a));
+		}
+	}
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+}
+}
+
+#endif
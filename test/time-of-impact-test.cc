@@ -0,0 +1,235 @@
+//////////////////////////////////////////////////////
+// @fileoverview Time of impact of fast colliders: exact
+//				 cases, and random sweeps against the
+//				 discrete check sampled along the step.
+//				 See test/run-tests.sh.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "test-util.h"
+#include "../colliders/distance.h"
+#include "../colliders/time-of-impact.h"
+
+using namespace ysd_phy_2d;
+using namespace ysd_phy_2d::test;
+
+namespace
+{
+
+const float kTolerance = 1e-4f;
+
+std::unique_ptr<BaseCollider> MakeCircle(uint16_t id, float radius, const Vector2& position)
+{
+	std::unique_ptr<BaseCollider> collider(new CircleCollider(id, std::make_shared<Circle>(radius)));
+	collider->Translate(position);
+	return collider;
+}
+
+// A box of a half size, anticlockwise.
+std::unique_ptr<BaseCollider> MakeBox(uint16_t id, const Vector2& half, const Vector2& position)
+{
+	Vector2 corners[] = { Vector2(-half.x(), -half.y()), Vector2(half.x(), -half.y()),
+						  Vector2(half.x(), half.y()), Vector2(-half.x(), half.y()) };
+	std::unique_ptr<BaseCollider> collider(new PolygonCollider(id, std::make_shared<ConvexPolygon>(corners, 4)));
+	collider->Translate(position);
+	return collider;
+}
+
+bool Near(float a, float b)
+{
+	return std::fabs(a - b) <= kTolerance;
+}
+
+bool Near(const Vector2& a, const Vector2& b)
+{
+	return Near(a.x(), b.x()) && Near(a.y(), b.y());
+}
+
+// The collision has the time, normal and points, the points in any order.
+void CheckImpact(const char* name, bool hit, const Collision& collision, uint16_t first, float time,
+				 const Vector2& normal, const std::vector<Vector2>& points)
+{
+	TEST_CHECK(hit, "%s: no impact", name);
+	if (!hit)
+		return;
+
+	TEST_CHECK(collision.first == first, "%s: first is %u, %u expected", name, collision.first, first);
+	TEST_CHECK(Near(collision.time_of_impact, time), "%s: time %g, %g expected", name, collision.time_of_impact, time);
+	TEST_CHECK(Near(collision.normal, normal), "%s: normal (%g, %g), (%g, %g) expected", name,
+			   collision.normal.x(), collision.normal.y(), normal.x(), normal.y());
+	TEST_CHECK(collision.point_count == points.size(), "%s: %u points, %zu expected", name,
+			   collision.point_count, points.size());
+	for (uint8_t i = 0; i < collision.point_count && i < points.size(); ++i)
+	{
+		const Vector2& point = collision.points[i];
+		bool expected = false;
+		for (const Vector2& p : points)
+		{
+			expected |= Near(point, p);
+		}
+		TEST_CHECK(expected, "%s: point (%g, %g) not expected", name, point.x(), point.y());
+	}
+}
+
+// A bullet ends at x = 30 after moving by 60 through a wall at x in
+// [-0.5, 0.5], y in [-10, 10]. Its front reaches the wall after 29 of 60.
+void TestBulletThroughWall()
+{
+	const Vector2 sweep(60, 0);
+	const float time = 29.0f / 60;
+	std::unique_ptr<BaseCollider> wall = MakeBox(1, Vector2(0.5f, 10), Vector2::kZero);
+	std::unique_ptr<BaseCollider> circle = MakeCircle(2, 0.5f, Vector2(30, 0));
+	std::unique_ptr<BaseCollider> square = MakeBox(3, Vector2(0.5f, 0.5f), Vector2(30, 0));
+
+	Collision collision;
+	bool hit = TimeOfImpact(*circle, sweep, *wall, Vector2::kZero, &collision);
+	CheckImpact("circle through wall", hit, collision, 2, time, Vector2(1, 0), { Vector2(-0.5f, 0) });
+
+	hit = TimeOfImpact(*wall, Vector2::kZero, *circle, sweep, &collision);
+	CheckImpact("wall against circle", hit, collision, 1, time, Vector2(-1, 0), { Vector2(-0.5f, 0) });
+
+	// The faces are parallel, the contact is the whole face of the square.
+	hit = TimeOfImpact(*square, sweep, *wall, Vector2::kZero, &collision);
+	CheckImpact("square through wall", hit, collision, 3, time, Vector2(1, 0),
+				{ Vector2(-0.5f, -0.5f), Vector2(-0.5f, 0.5f) });
+
+	hit = TimeOfImpact(*wall, Vector2::kZero, *square, sweep, &collision);
+	CheckImpact("wall against square", hit, collision, 1, time, Vector2(-1, 0),
+				{ Vector2(-0.5f, -0.5f), Vector2(-0.5f, 0.5f) });
+
+	// A wide mover against a narrow post, the contact is the post's face.
+	std::unique_ptr<BaseCollider> post = MakeBox(4, Vector2(0.5f, 0.5f), Vector2::kZero);
+	std::unique_ptr<BaseCollider> board = MakeBox(5, Vector2(0.5f, 10), Vector2(30, 0));
+	hit = TimeOfImpact(*board, sweep, *post, Vector2::kZero, &collision);
+	CheckImpact("board against post", hit, collision, 5, time, Vector2(1, 0),
+				{ Vector2(-0.5f, -0.5f), Vector2(-0.5f, 0.5f) });
+
+	// Both move, the points are where they touch at that time. The wall
+	// moves by (-20, 0) and ends at x = 0, it starts at x = 20.
+	const Vector2 wall_sweep(-20, 0);
+	const float both_time = 49.0f / 80;
+	hit = TimeOfImpact(*square, sweep, *wall, wall_sweep, &collision);
+	const float wall_x = 20 - 20 * both_time - 0.5f;
+	CheckImpact("square and wall moving", hit, collision, 3, both_time, Vector2(1, 0),
+				{ Vector2(wall_x, -0.5f), Vector2(wall_x, 0.5f) });
+}
+
+// Colliders overlapping at the start touch at 0, and colliders passing
+// just beside each other do not touch.
+void TestStartAndMiss()
+{
+	std::unique_ptr<BaseCollider> wall = MakeBox(1, Vector2(0.5f, 10), Vector2::kZero);
+	Collision collision;
+
+	// Starts at x = 0.2, inside the wall.
+	std::unique_ptr<BaseCollider> circle = MakeCircle(2, 0.5f, Vector2(10.2f, 0));
+	bool hit = TimeOfImpact(*circle, Vector2(10, 0), *wall, Vector2::kZero, &collision);
+	TEST_CHECK(hit && collision.time_of_impact == 0, "circle in the wall at the start: hit %d at %g", hit,
+			   hit ? collision.time_of_impact : -1);
+
+	std::unique_ptr<BaseCollider> square = MakeBox(3, Vector2(0.5f, 0.5f), Vector2(10.2f, 0));
+	hit = TimeOfImpact(*square, Vector2(10, 0), *wall, Vector2::kZero, &collision);
+	TEST_CHECK(hit && collision.time_of_impact == 0, "square in the wall at the start: hit %d at %g", hit,
+			   hit ? collision.time_of_impact : -1);
+
+	// Beside the end of the wall by 0.1.
+	circle = MakeCircle(2, 0.5f, Vector2(30, 10.6f));
+	hit = TimeOfImpact(*circle, Vector2(60, 0), *wall, Vector2::kZero, &collision);
+	TEST_CHECK(!hit, "circle beside the wall hits at %g", collision.time_of_impact);
+
+	square = MakeBox(3, Vector2(0.5f, 0.5f), Vector2(30, 10.6f));
+	hit = TimeOfImpact(*square, Vector2(60, 0), *wall, Vector2::kZero, &collision);
+	TEST_CHECK(!hit, "square beside the wall hits at %g", collision.time_of_impact);
+
+	std::unique_ptr<BaseCollider> other = MakeCircle(4, 0.5f, Vector2(0, 1.1f));
+	circle = MakeCircle(2, 0.5f, Vector2(30, 0));
+	hit = TimeOfImpact(*circle, Vector2(60, 0), *other, Vector2::kZero, &collision);
+	TEST_CHECK(!hit, "circle beside a circle hits at %g", collision.time_of_impact);
+}
+
+// Random pairs of circles and pentagons on random sweeps, against the
+// discrete check at many times of the step.
+void TestSampled()
+{
+	const int kPairCount = 1000;
+	const int kSteps = 1000;
+	RandomScene scene(24, 20);
+	ColliderPool pool;
+	std::uniform_real_distribution<float> length(5, 40);
+	std::uniform_real_distribution<float> angle(0, 6.2831853f);
+
+	int hits = 0;
+	for (int i = 0; i < kPairCount; ++i)
+	{
+		uint16_t id = static_cast<uint16_t>(i * 2);
+		ColliderHandle handle1 = scene.Add(pool, id + (i % 2));
+		ColliderHandle handle2 = scene.Add(pool, id + (i % 3 == 0 ? 0 : 1) + 2 * kPairCount);
+		BaseCollider& collider1 = *pool.collider(handle1);
+		BaseCollider& collider2 = *pool.collider(handle2);
+
+		// The first one crosses the second one's place on a random line.
+		float a = angle(scene.rng());
+		Vector2 sweep1 = Vector2(std::cos(a), std::sin(a)) * length(scene.rng());
+		Vector2 sweep2 = scene.Jitter(3);
+		collider1.SetTransform(collider2.position() + sweep1 * 0.5f + scene.Jitter(3), collider1.angle(), collider1.scale());
+
+		Collision collision;
+		bool hit = TimeOfImpact(collider1, sweep1, collider2, sweep2, &collision);
+
+		// The first time the discrete check finds them touching.
+		const Vector2 end1 = collider1.position(), end2 = collider2.position();
+		int first_step = -1;
+		for (int step = 0; step <= kSteps && first_step < 0; ++step)
+		{
+			float t = static_cast<float>(step) / kSteps;
+			collider1.SetTransform(end1 - sweep1 * (1 - t), collider1.angle(), collider1.scale());
+			collider2.SetTransform(end2 - sweep2 * (1 - t), collider2.angle(), collider2.scale());
+			if (collider1.Check(collider2, nullptr))
+				first_step = step;
+		}
+
+		if (first_step >= 0)
+		{
+			++hits;
+			float earliest = (first_step - 1.0f) / kSteps - 1e-3f;
+			float latest = static_cast<float>(first_step) / kSteps + 1e-3f;
+			TEST_CHECK(hit && collision.time_of_impact >= earliest && collision.time_of_impact <= latest,
+					   "pair %d: impact %d at %g, first touching step at %g", i, hit,
+					   hit ? collision.time_of_impact : -1, static_cast<float>(first_step) / kSteps);
+		}
+
+		// The points are on both colliders at the time of impact. Colliders
+		// overlapping at the start only get a point along the sweep.
+		if (hit && first_step != 0)
+		{
+			float t = collision.time_of_impact;
+			collider1.SetTransform(end1 - sweep1 * (1 - t), collider1.angle(), collider1.scale());
+			collider2.SetTransform(end2 - sweep2 * (1 - t), collider2.angle(), collider2.scale());
+			for (uint8_t p = 0; p < collision.point_count; ++p)
+			{
+				float d1 = Distance(collider1, collision.points[p]);
+				float d2 = Distance(collider2, collision.points[p]);
+				TEST_CHECK(d1 < 1e-2f && d2 < 1e-2f, "pair %d: point %u is %g and %g from the colliders", i, p, d1, d2);
+			}
+		}
+
+		pool.Remove(handle1);
+		pool.Remove(handle2);
+	}
+	TEST_CHECK(hits > kPairCount / 2, "only %d of %d pairs touch", hits, kPairCount);
+}
+
+}
+
+int main()
+{
+	TestBulletThroughWall();
+	TestStartAndMiss();
+	TestSampled();
+	return Finish("time-of-impact-test");
+}
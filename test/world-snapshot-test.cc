@@ -0,0 +1,118 @@
+//////////////////////////////////////////////////////
+// @fileoverview Queries of the world snapshot against
+//				 the quad tree and brute force. See
+//				 test/run-tests.sh.
+// @author	ysd
+//////////////////////////////////////////////////////
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "test-util.h"
+#include "../colliders/raycast.h"
+#include "../scene/quad-tree.h"
+#include "../scene/world-snapshot.h"
+
+using namespace ysd_phy_2d;
+using namespace ysd_phy_2d::test;
+
+namespace
+{
+
+const float kHalfSize = 200;
+const uint16_t kColliderCount = 3000;
+const int kQueryCount = 2000;
+
+// The same hit as the quad tree's, bit for bit, for rays and segments
+// from inside and outside of the world.
+void TestRaycast(float looseness)
+{
+	ColliderPool pool;
+	QuadTree tree(&pool, kHalfSize * 2, kHalfSize * 2, 8, looseness);
+	RandomScene scene(7, kHalfSize);
+	for (uint16_t id = 0; id < kColliderCount; ++id)
+	{
+		tree.Insert(scene.Add(pool, id));
+	}
+
+	WorldSnapshot snapshot;
+	snapshot.Build(pool, 1);
+	TEST_CHECK(snapshot.size() == kColliderCount, "%zu colliders in the snapshot", snapshot.size());
+
+	int hits = 0;
+	for (int i = 0; i < kQueryCount; ++i)
+	{
+		Ray ray;
+		ray.origin = scene.Point(1.3f);
+		if (i % 2 == 0)
+		{
+			ray.direction = scene.Point(1.3f) - ray.origin;
+			ray.max_fraction = 1;
+		}
+		else
+		{
+			ray.direction = scene.Jitter(1);
+			ray.direction = ray.direction / ray.direction.length();
+			ray.max_fraction = kHalfSize;
+		}
+
+		RaycastHit expected, found;
+		bool tree_hit = tree.Raycast(ray, &expected);
+		bool snapshot_hit = snapshot.Raycast(ray, &found);
+		TEST_CHECK(tree_hit == snapshot_hit, "ray %d: hit %d, %d expected", i, snapshot_hit, tree_hit);
+		if (!tree_hit || !snapshot_hit)
+			continue;
+
+		++hits;
+		TEST_CHECK(found.fraction == expected.fraction, "ray %d: fraction %g, %g expected", i, found.fraction, expected.fraction);
+		TEST_CHECK(found.id == expected.id || found.fraction == expected.fraction, "ray %d: id %u, %u expected", i, found.id, expected.id);
+		TEST_CHECK(found.point == expected.point && found.normal == expected.normal, "ray %d: point or normal differ", i);
+	}
+	TEST_CHECK(hits > kQueryCount / 4, "only %d rays hit", hits);
+}
+
+// QueryRegion against the bounds of the pool.
+void TestQueryRegion()
+{
+	ColliderPool pool;
+	RandomScene scene(8, kHalfSize);
+	for (uint16_t id = 0; id < kColliderCount; ++id)
+	{
+		scene.Add(pool, id);
+	}
+
+	WorldSnapshot snapshot;
+	snapshot.Build(pool, 1);
+
+	std::vector<uint16_t> ids(kColliderCount);
+	for (int i = 0; i < kQueryCount; ++i)
+	{
+		Vector2 center = scene.Point(1.2f), extent = scene.Jitter(30);
+		Vector2 half(std::fabs(extent.x()), std::fabs(extent.y()));
+		Bound region{ center - half, center + half };
+
+		std::size_t count = snapshot.QueryRegion(region, ids.data(), ids.size());
+		std::vector<uint16_t> found(ids.begin(), ids.begin() + count);
+		std::sort(found.begin(), found.end());
+
+		std::vector<uint16_t> expected;
+		for (ColliderHandle handle = 0; handle < pool.capacity(); ++handle)
+		{
+			if (pool.collider(handle) != nullptr && BoundContactBound(region, pool.bound(handle)))
+				expected.push_back(pool.id(handle));
+		}
+		std::sort(expected.begin(), expected.end());
+		TEST_CHECK(found == expected, "region %d: %zu colliders, %zu expected", i, found.size(), expected.size());
+	}
+}
+
+}
+
+int main()
+{
+	TestRaycast(1);
+	TestRaycast(2);
+	TestQueryRegion();
+	return Finish("world-snapshot-test");
+}